@@ -128,12 +128,12 @@ const WireframePolygon Cube = {
     }
 };
 
-const Matrix<double, 2, 3> project2D = {{200, 0,     0},
-                                        {0,   200,   0}};
+constexpr Matrix<double, 2, 3> project2D = {{200, 0,     0},
+                                            {0,   200,   0}};
 
-const vec3d xaxis = {1, 0, 0};
-const vec3d yaxis = {0, 1, 0};
-const vec3d zaxis = {0, 0, 1};
+constexpr vec3d xaxis = {1, 0, 0};
+constexpr vec3d yaxis = {0, 1, 0};
+constexpr vec3d zaxis = {0, 0, 1};
 
 /* map s from [a1...a2] to [b1...b2] */
 inline double map(double s, double a1, double a2, double b1, double b2) { return b1 + (s - a1) * (b2 - b1) / (a2 - a1); }
@@ -0,0 +1,283 @@
+#ifndef _ALLOC_STATS_H_
+#define _ALLOC_STATS_H_
+
+/*
+    Heap allocation counts
+
+    With MYGL_ALLOC_STATS defined, this header replaces the global operator new and delete, so it must be included in
+    one translation unit only (as is the case for mygl.h anyway). Every allocation is counted, with its bytes, under the
+    category that the allocating thread is in at the time: MYGL_ALLOC_CATEGORY(FRAMEBUFFER) puts the rest of the scope
+    under FRAMEBUFFER, and anything outside of such a scope is USER. A block is given back to the category it was taken
+    from, so the live bytes and their peak stay right whichever scope frees it. Without MYGL_ALLOC_STATS the macro expands
+    to nothing and GetAllocStats returns zeros.
+
+    Vector and Matrix keep their elements in place and never allocate. VECTOR is for the arrays of vectors, eg.
+    RendererBase3D's vertex arrays; matrices are only ever kept one by one, so they have no category. FRAMEBUFFER is
+    the renderer's pixels, depth and the per tile and per block state, the bins of the binned triangles included.
+
+    Allocations through malloc are not seen, nor are the aligned forms of operator new, which C++14 does not have.
+*/
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <new>
+
+#if defined(MYGL_ALLOC_STATS)
+#define MYGL_ALLOC_CONCAT_(a, b) a##b
+#define MYGL_ALLOC_CONCAT(a, b) MYGL_ALLOC_CONCAT_(a, b)
+#define MYGL_ALLOC_CATEGORY(category) ::mygl::AllocScope MYGL_ALLOC_CONCAT(allocScope, __LINE__)(::mygl::AllocCategory::category)
+#else
+#define MYGL_ALLOC_CATEGORY(category) ((void)0)
+#endif
+
+namespace mygl
+{
+#if defined(MYGL_ALLOC_STATS)
+    const bool ALLOC_STATS = true;
+#else
+    const bool ALLOC_STATS = false;
+#endif
+
+    enum class AllocCategory { VECTOR, FRAMEBUFFER, USER };
+
+    const int ALLOC_CATEGORIES = 3;
+
+    inline const char* AllocCategoryName(AllocCategory category)
+    {
+        static const char* const names[ALLOC_CATEGORIES] = {"vector", "framebuffer", "user"};
+        return names[int(category)];
+    }
+
+    struct AllocCounts
+    {
+        int64_t allocations = 0;
+        int64_t bytes = 0; // allocated, what was freed is not taken off
+        int64_t live = 0;  // bytes allocated and not freed yet
+        int64_t peak = 0;  // the most live bytes since ResetAllocPeaks
+    };
+
+    struct AllocStats
+    {
+        AllocCounts counts[ALLOC_CATEGORIES];
+
+        const AllocCounts& operator[](AllocCategory category) const { return counts[int(category)]; }
+
+        AllocCounts Total() const; // live and peak summed over the categories, so the peak may be more than there ever was
+    };
+
+    AllocCounts AllocStats::Total() const
+    {
+        AllocCounts total;
+
+        for (const AllocCounts& c : counts)
+        {
+            total.allocations += c.allocations;
+            total.bytes += c.bytes;
+            total.live += c.live;
+            total.peak += c.peak;
+        }
+
+        return total;
+    }
+
+    // Everything since the program started, the peaks since ResetAllocPeaks
+    AllocStats GetAllocStats();
+
+    // Starts the peaks over from the bytes live now, eg. at the start of a frame
+    void ResetAllocPeaks();
+
+    // The allocations and bytes from start to now; the live bytes and peaks as they are now
+    AllocStats GetAllocStatsSince(const AllocStats& start);
+
+    // Puts the calling thread's allocations under category until the scope ends, see MYGL_ALLOC_CATEGORY
+    class AllocScope
+    {
+    public:
+        explicit AllocScope(AllocCategory category);
+        ~AllocScope();
+
+        AllocScope(const AllocScope&) = delete;
+        AllocScope& operator=(const AllocScope&) = delete;
+    private:
+        AllocCategory previous;
+    };
+
+namespace alloc
+{
+    struct Counters
+    {
+        std::atomic<int64_t> allocations;
+        std::atomic<int64_t> bytes;
+        std::atomic<int64_t> live;
+        std::atomic<int64_t> peak;
+    };
+
+    // Constant initialized, so they can be counted into before anything else is constructed
+    Counters counters[ALLOC_CATEGORIES];
+
+    inline AllocCategory& CurrentCategory()
+    {
+        thread_local AllocCategory category = AllocCategory::USER;
+        return category;
+    }
+
+    // Put in front of every block: its size and category. Keeps the block as aligned as malloc's
+    struct alignas(std::max_align_t) Header
+    {
+        size_t size;
+        int category;
+    };
+
+    inline void* Allocate(size_t size)
+    {
+        Header* header = static_cast<Header*>(std::malloc(sizeof(Header) + size));
+
+        if (header == NULL)
+        {
+            return NULL;
+        }
+
+        int category = int(CurrentCategory());
+        Counters& c = counters[category];
+
+        header->size = size;
+        header->category = category;
+
+        c.allocations.fetch_add(1, std::memory_order_relaxed);
+        c.bytes.fetch_add(size, std::memory_order_relaxed);
+
+        int64_t live = c.live.fetch_add(size, std::memory_order_relaxed) + size;
+        int64_t peak = c.peak.load(std::memory_order_relaxed);
+
+        while (live > peak && !c.peak.compare_exchange_weak(peak, live, std::memory_order_relaxed))
+        {}
+
+        return header + 1;
+    }
+
+    inline void Free(void* p)
+    {
+        if (p == NULL) return;
+
+        // back to the header through an integer: once operator delete is inlined, GCC takes p for the start of the
+        // object that operator new returned, and warns about anything in front of it
+        Header* header = reinterpret_cast<Header*>(reinterpret_cast<uintptr_t>(p) - sizeof(Header));
+
+        counters[header->category].live.fetch_sub(header->size, std::memory_order_relaxed);
+
+        std::free(header);
+    }
+}
+
+    AllocStats GetAllocStats()
+    {
+        AllocStats stats;
+
+        for (int i = 0; i < ALLOC_CATEGORIES; ++i)
+        {
+            alloc::Counters& c = alloc::counters[i];
+
+            stats.counts[i].allocations = c.allocations.load(std::memory_order_relaxed);
+            stats.counts[i].bytes = c.bytes.load(std::memory_order_relaxed);
+            stats.counts[i].live = c.live.load(std::memory_order_relaxed);
+            stats.counts[i].peak = c.peak.load(std::memory_order_relaxed);
+        }
+
+        return stats;
+    }
+
+    void ResetAllocPeaks()
+    {
+        for (alloc::Counters& c : alloc::counters)
+        {
+            c.peak.store(c.live.load(std::memory_order_relaxed), std::memory_order_relaxed);
+        }
+    }
+
+    AllocStats GetAllocStatsSince(const AllocStats& start)
+    {
+        AllocStats stats = GetAllocStats();
+
+        for (int i = 0; i < ALLOC_CATEGORIES; ++i)
+        {
+            stats.counts[i].allocations -= start.counts[i].allocations;
+            stats.counts[i].bytes -= start.counts[i].bytes;
+        }
+
+        return stats;
+    }
+
+    AllocScope::AllocScope(AllocCategory category)
+      : previous(alloc::CurrentCategory())
+    {
+        alloc::CurrentCategory() = category;
+    }
+
+    AllocScope::~AllocScope()
+    {
+        alloc::CurrentCategory() = previous;
+    }
+}
+
+#if defined(MYGL_ALLOC_STATS)
+void* operator new(size_t size)
+{
+    void* p = mygl::alloc::Allocate(size);
+
+    if (p == NULL)
+    {
+        throw std::bad_alloc();
+    }
+
+    return p;
+}
+
+void* operator new[](size_t size)
+{
+    return operator new(size);
+}
+
+void* operator new(size_t size, const std::nothrow_t&) noexcept
+{
+    return mygl::alloc::Allocate(size);
+}
+
+void* operator new[](size_t size, const std::nothrow_t&) noexcept
+{
+    return mygl::alloc::Allocate(size);
+}
+
+void operator delete(void* p) noexcept
+{
+    mygl::alloc::Free(p);
+}
+
+void operator delete[](void* p) noexcept
+{
+    mygl::alloc::Free(p);
+}
+
+void operator delete(void* p, size_t) noexcept
+{
+    mygl::alloc::Free(p);
+}
+
+void operator delete[](void* p, size_t) noexcept
+{
+    mygl::alloc::Free(p);
+}
+
+void operator delete(void* p, const std::nothrow_t&) noexcept
+{
+    mygl::alloc::Free(p);
+}
+
+void operator delete[](void* p, const std::nothrow_t&) noexcept
+{
+    mygl::alloc::Free(p);
+}
+#endif
+
+#endif /* _ALLOC_STATS_H_ */
@@ -0,0 +1,499 @@
+/* g++ benchmark.cpp -o benchmark -std=c++14 -O2 -march=native -pthread */
+/* build again with -DMYGL_NO_SIMD to compare against the scalar kernels */
+/* build again with -DMYGL_TILED_FRAMEBUFFER to compare the framebuffer layouts, see the raster benchmarks */
+/* with -DMYGL_ALLOC_STATS the allocations are counted by allocstats.h rather than by the operator new below */
+/* build with -O3 -DMYGL_BOUNDS_CHECK=0 (or 1) -fopt-info-vec-optimized to see which loops vectorize without (or with) bounds checks */
+
+/*
+    Usage: benchmark [--csv | --json] [filter]
+
+    Prints ns/op, heap allocations/op and throughput (millions of ops per second) of every benchmark whose name
+    contains filter. --csv and --json print the same numbers in machine-readable form so that two builds can be
+    diffed for regressions.
+
+    The raster benchmarks draw frames of random triangles through RendererBase3D at increasing resolutions, one op
+    being a triangle, clear and present included. Their type is the framebuffer layout.
+*/
+
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <iomanip>
+#include <new>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "mygl.h"
+
+using namespace mygl;
+
+const int BATCH = 1024;      // distinct operands per benchmark so the work cannot be hoisted out of the loop
+const int ITERATIONS = 2000; // passes over the batch
+const int FRAMES = 20;       // per raster benchmark
+const int TRIANGLES = 4096;  // per frame
+
+volatile int LENGTH = 64; // trip count of the indexed loop, only known at run time
+
+#if defined(MYGL_ALLOC_STATS)
+// allocstats.h has replaced operator new already, and counts every allocation of the program
+size_t Allocations()
+{
+    return size_t(GetAllocStats().Total().allocations);
+}
+#else
+// Every heap allocation of the program goes through here, from the raster worker threads too
+static std::atomic<size_t> allocations(0);
+
+void* operator new(size_t size)
+{
+    ++allocations;
+
+    if (void* p = std::malloc(size ? size : 1))
+    {
+        return p;
+    }
+
+    throw std::bad_alloc();
+}
+
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete(void* p, size_t) noexcept { ::operator delete(p); }
+
+size_t Allocations()
+{
+    return allocations;
+}
+#endif
+
+enum class Format { TABLE, CSV, JSON };
+
+struct Result
+{
+    std::string name;
+    std::string type;
+    double ns;     // per op
+    double allocs; // per op
+};
+
+Format format = Format::TABLE;
+std::string filter;
+std::vector<Result> results;
+
+// Keep the optimizer from discarding results
+template<typename T>
+inline void DoNotOptimize(const T& value)
+{
+    asm volatile("" : : "r,m"(value) : "memory");
+}
+
+void Record(const std::string& name, const std::string& type, double ns, double allocs)
+{
+    results.push_back({name, type, ns, allocs});
+
+    if (format == Format::TABLE)
+    {
+        std::cout << std::left << std::setw(30) << name << std::setw(8) << type << std::right << std::fixed
+                  << std::setw(10) << std::setprecision(2) << ns << " ns/op"
+                  << std::setw(8) << std::setprecision(2) << allocs << " allocs/op"
+                  << std::setw(10) << std::setprecision(1) << 1e3 / ns << " Mops/s\n";
+    }
+}
+
+// One op per call, fn(i) works on the i-th operands of the batch
+template<typename Fn>
+void Run(const std::string& name, const std::string& type, Fn fn)
+{
+    if (name.find(filter) == std::string::npos) return;
+
+    fn(0); // warm up
+
+    size_t allocs = Allocations();
+    auto start = std::chrono::steady_clock::now();
+
+    for (int it = 0; it < ITERATIONS; ++it)
+    {
+        for (int i = 0; i < BATCH; ++i)
+        {
+            fn(i);
+        }
+    }
+
+    auto end = std::chrono::steady_clock::now();
+    double ops = double(ITERATIONS) * BATCH;
+
+    Record(name, type, std::chrono::duration<double, std::nano>(end - start).count() / ops, (Allocations() - allocs) / ops);
+}
+
+// n ops per call, fn() processes a whole batch (eg. n points)
+template<typename Fn>
+void RunBatch(const std::string& name, const std::string& type, int n, Fn fn)
+{
+    if (name.find(filter) == std::string::npos) return;
+
+    fn(); // warm up
+
+    size_t allocs = Allocations();
+    auto start = std::chrono::steady_clock::now();
+
+    for (int it = 0; it < ITERATIONS; ++it)
+    {
+        fn();
+    }
+
+    auto end = std::chrono::steady_clock::now();
+    double ops = double(ITERATIONS) * n;
+
+    Record(name, type, std::chrono::duration<double, std::nano>(end - start).count() / ops, (Allocations() - allocs) / ops);
+}
+
+template<typename T> const char* TypeName();
+template<> const char* TypeName<float>() { return "float"; }
+template<> const char* TypeName<double>() { return "double"; }
+
+template<typename T, size_t M, size_t N>
+std::vector<Matrix<T, M, N>> RandomMatrices(std::mt19937& rng)
+{
+    std::uniform_real_distribution<T> dist(-10, 10);
+    std::vector<Matrix<T, M, N>> ms(BATCH);
+
+    for (auto& m : ms)
+    {
+        for (size_t k = 0; k < M * N; ++k)
+        {
+            m.Flat(k) = dist(rng);
+        }
+    }
+
+    return ms;
+}
+
+template<typename T, size_t N>
+std::vector<Vector<T, N>> RandomVectors(std::mt19937& rng)
+{
+    std::uniform_real_distribution<T> dist(-10, 10);
+    std::vector<Vector<T, N>> vs(BATCH);
+
+    for (auto& v : vs)
+    {
+        for (size_t k = 0; k < N; ++k)
+        {
+            v[k] = dist(rng);
+        }
+    }
+
+    return vs;
+}
+
+template<typename T>
+void RunVectors(std::mt19937& rng)
+{
+    const std::string type = TypeName<T>();
+
+    auto u = RandomVectors<T, 4>(rng);
+    auto v = RandomVectors<T, 4>(rng);
+    auto p = RandomVectors<T, 3>(rng);
+    auto q = RandomVectors<T, 3>(rng);
+
+    Run("vec4+vec4", type, [&](int i) { Vector<T, 4> r = u[i] + v[i]; DoNotOptimize(r); });
+    Run("vec4*scalar", type, [&](int i) { Vector<T, 4> r = u[i] * v[i][0]; DoNotOptimize(r); });
+    Run("vec4+vec4*scalar", type, [&](int i) { Vector<T, 4> r = u[i] + v[i] * u[i][1]; DoNotOptimize(r); });
+    Run("dot4", type, [&](int i) { DoNotOptimize(u[i] * v[BATCH - 1 - i]); });
+    Run("Magnitude4", type, [&](int i) { DoNotOptimize(u[i].Magnitude()); });
+    Run("Unit4", type, [&](int i) { Vector<T, 4> r = u[i].Unit(); DoNotOptimize(r); });
+    Run("CrossProduct", type, [&](int i) { Vector<T, 3> r = CrossProduct(p[i], q[i]); DoNotOptimize(r); });
+
+    // A loop through operator[] whose trip count the compiler cannot see, so with bounds checks on it stays scalar
+    Vector<T, 64> big, scaled;
+
+    for (int i = 0; i < 64; ++i)
+    {
+        big[i] = u[i][0];
+    }
+
+    Run("indexed loop (64)", type, [&](int i) { int n = LENGTH; for (int k = 0; k < n; ++k) { scaled[k] = big[k] * v[i][0]; } DoNotOptimize(scaled); });
+}
+
+// mat*vec, mat*mat and Transpose of one size
+template<typename T, size_t N>
+void RunSize(std::mt19937& rng)
+{
+    const std::string type = TypeName<T>();
+    const std::string n = std::to_string(N);
+
+    auto a = RandomMatrices<T, N, N>(rng);
+    auto b = RandomMatrices<T, N, N>(rng);
+    auto v = RandomVectors<T, N>(rng);
+
+    Run("mat" + n + "*vec" + n, type, [&](int i) { Vector<T, N> r = a[i] * v[i]; DoNotOptimize(r); });
+    Run("mat" + n + "*mat" + n, type, [&](int i) { SquareMatrix<T, N> r = a[i] * b[i]; DoNotOptimize(r); });
+    Run("mat" + n + "*mat" + n + "*vec" + n, type, [&](int i) { Vector<T, N> r = a[i] * b[i] * v[i]; DoNotOptimize(r); });
+    Run("Transpose" + n, type, [&](int i) { SquareMatrix<T, N> r = a[i].Transpose(); DoNotOptimize(r); });
+}
+
+template<typename T>
+void RunTransforms(std::mt19937& rng)
+{
+    const std::string type = TypeName<T>();
+
+    auto a = RandomMatrices<T, 4, 4>(rng);
+    auto b = RandomMatrices<T, 4, 4>(rng);
+    auto v = RandomVectors<T, 4>(rng);
+
+    for (auto& m : a)
+    {
+        m[0][0] += 50; // keep a[i] comfortably invertible
+        m[1][1] += 50;
+        m[2][2] += 50;
+        m[3][3] += 50;
+    }
+
+    Run("Inverse4", type, [&](int i) { SquareMatrix<T, 4> r = Inverse4<T>(a[i]); DoNotOptimize(r); });
+
+    std::vector<Affine3<T>> fa(a.begin(), a.end()), fb(b.begin(), b.end());
+
+    Run("Affine3*Affine3", type, [&](int i) { Affine3<T> r = fa[i] * fb[i]; DoNotOptimize(r); });
+    Run("Affine3*vec4", type, [&](int i) { Vector<T, 4> r = fa[i] * v[i]; DoNotOptimize(r); });
+    Run("Affine3::Inverse", type, [&](int i) { Affine3<T> r = fa[i].Inverse(); DoNotOptimize(r); });
+    Run("Affine3::InverseRigid", type, [&](int i) { Affine3<T> r = fa[i].InverseRigid(); DoNotOptimize(r); });
+
+    std::vector<Quaternion<T>> q(BATCH);
+    std::vector<Vector<T, 3>> p(BATCH), rotated(BATCH);
+
+    for (int i = 0; i < BATCH; ++i)
+    {
+        q[i] = Quaternion<T>(v[i].Demote(), v[BATCH - 1 - i][3]);
+        p[i] = v[BATCH - 1 - i].Demote();
+    }
+
+    Run("Quaternion*Quaternion", type, [&](int i) { Quaternion<T> r = q[i] * q[BATCH - 1 - i]; DoNotOptimize(r); });
+    Run("Rotate3D", type, [&](int i) { Vector<T, 3> r = Rotate3D(p[i], q[i]); DoNotOptimize(r); });
+
+    // per point, batches of BATCH points
+    std::vector<Vector<T, 4>> out(BATCH);
+
+    RunBatch("TransformPoints", type, BATCH, [&]() { TransformPoints(a[0], v.data(), out.data(), BATCH); DoNotOptimize(out[0]); });
+    RunBatch("ProjectPoints", type, BATCH, [&]() { ProjectPoints(a[0], b[0], v.data(), out.data(), BATCH); DoNotOptimize(out[0]); });
+    RunBatch("Rotate3D (batch)", type, BATCH, [&]() { Rotate3D(q[0], p.data(), rotated.data(), BATCH); DoNotOptimize(rotated[0]); });
+}
+
+template<typename T>
+void RunFactories(std::mt19937& rng)
+{
+    const std::string type = TypeName<T>();
+
+    std::uniform_real_distribution<T> dist(1, 10);
+    std::vector<T> s(BATCH), t(BATCH);
+
+    for (int i = 0; i < BATCH; ++i)
+    {
+        s[i] = dist(rng);
+        t[i] = dist(rng);
+    }
+
+    auto axes = RandomVectors<T, 3>(rng);
+    std::vector<Quaternion<T>> q(BATCH);
+
+    for (int i = 0; i < BATCH; ++i)
+    {
+        q[i] = Quaternion<T>(axes[i], s[i]);
+    }
+
+    Run("CreateIdentity4", type, [&](int i) { SquareMatrix<T, 4> r = CreateIdentity<T, 4>(); r[0][0] = s[i]; DoNotOptimize(r); });
+    Run("CreateScalingMatrix2", type, [&](int i) { SquareMatrix<T, 2> r = CreateScalingMatrix2<T>(s[i], t[i]); DoNotOptimize(r); });
+    Run("CreateRotationMatrix2", type, [&](int i) { SquareMatrix<T, 2> r = CreateRotationMatrix2<T>(s[i]); DoNotOptimize(r); });
+    Run("CreateScalingMatrix3", type, [&](int i) { SquareMatrix<T, 3> r = CreateScalingMatrix3<T>(s[i], t[i], s[i]); DoNotOptimize(r); });
+    Run("CreateRotationXMatrix3", type, [&](int i) { SquareMatrix<T, 3> r = CreateRotationXMatrix3<T>(s[i]); DoNotOptimize(r); });
+    Run("CreateRotationMatrix3(ypr)", type, [&](int i) { SquareMatrix<T, 3> r = CreateRotationMatrix3<T>(s[i], t[i], s[i]); DoNotOptimize(r); });
+    Run("CreateRotationMatrix3(q)", type, [&](int i) { SquareMatrix<T, 3> r = CreateRotationMatrix3<T>(q[i]); DoNotOptimize(r); });
+    Run("CreateTranslationMatrix4", type, [&](int i) { SquareMatrix<T, 4> r = CreateTranslationMatrix4<T>(s[i], t[i], s[i]); DoNotOptimize(r); });
+    Run("CreateScalingMatrix4", type, [&](int i) { SquareMatrix<T, 4> r = CreateScalingMatrix4<T>(s[i], t[i], s[i]); DoNotOptimize(r); });
+    Run("CreateRotationXMatrix4", type, [&](int i) { SquareMatrix<T, 4> r = CreateRotationXMatrix4<T>(s[i]); DoNotOptimize(r); });
+    Run("CreateRotationMatrix4(ypr)", type, [&](int i) { SquareMatrix<T, 4> r = CreateRotationMatrix4<T>(s[i], t[i], s[i]); DoNotOptimize(r); });
+    Run("CreateRotationMatrix4(q)", type, [&](int i) { SquareMatrix<T, 4> r = CreateRotationMatrix4<T>(q[i]); DoNotOptimize(r); });
+    Run("CreateOrthographic4", type, [&](int i) { SquareMatrix<T, 4> r = CreateOrthographic4<T>(-s[i], s[i], -t[i], t[i], 0, 100); DoNotOptimize(r); });
+    Run("CreateViewingFrustum4", type, [&](int i) { SquareMatrix<T, 4> r = CreateViewingFrustum4<T>(-s[i], s[i], -t[i], t[i], 1, 100); DoNotOptimize(r); });
+    Run("CreatePerspective4", type, [&](int i) { SquareMatrix<T, 4> r = CreatePerspective4<T>(s[i] * 10, t[i], 1, 100); DoNotOptimize(r); });
+}
+
+template<typename T>
+void RunAll()
+{
+    std::mt19937 rng(42);
+
+    RunVectors<T>(rng);
+    RunSize<T, 2>(rng);
+    RunSize<T, 3>(rng);
+    RunSize<T, 4>(rng);
+    RunTransforms<T>(rng);
+    RunFactories<T>(rng);
+}
+
+// Draws the same frame of triangles again and again
+class RasterBenchmark : public RendererBase3D
+{
+public:
+    RasterBenchmark(int width, int height, float size, std::mt19937& rng)
+      : RendererBase3D(width, height)
+    {
+        std::uniform_real_distribution<float> x(0, width - size), y(0, height - size), d(0, size), z(1, 100);
+        std::uniform_int_distribution<int> c(0, 255);
+
+        // triangles of about size pixels across, all over the screen
+        for (int i = 0; i < TRIANGLES; ++i)
+        {
+            vec3f corner(x(rng), y(rng), 0);
+
+            triangles.push_back({corner + vec3f(d(rng), d(rng), z(rng)), corner + vec3f(d(rng), d(rng), z(rng)),
+                                 corner + vec3f(d(rng), d(rng), z(rng)), Colour(c(rng), c(rng), c(rng), 255)});
+        }
+    }
+
+    void Init() {}
+    void Update() {}
+
+    void Render()
+    {
+        for (const Triangle& t : triangles)
+        {
+            DrawFilledTriangleBarycentric(t.v1, t.v2, t.v3, t.colour);
+        }
+    }
+
+    void Frame()
+    {
+        ClearScreen();
+        Render();
+        DoNotOptimize(Present()[0]);
+    }
+private:
+    struct Triangle
+    {
+        vec3f v1, v2, v3;
+        Colour colour;
+    };
+
+    std::vector<Triangle> triangles;
+};
+
+const char* Layout()
+{
+    return TILED_FRAMEBUFFER ? "tiled" : "linear";
+}
+
+void RunRaster(const std::string& name, int width, int height, float size, int threads, std::mt19937& rng)
+{
+    if (name.find(filter) == std::string::npos) return;
+
+    RasterBenchmark renderer(width, height, size, rng);
+
+    renderer.SetRasterThreads(threads);
+    renderer.Frame(); // warm up
+
+    size_t allocs = Allocations();
+    auto start = std::chrono::steady_clock::now();
+
+    for (int it = 0; it < FRAMES; ++it)
+    {
+        renderer.Frame();
+    }
+
+    auto end = std::chrono::steady_clock::now();
+    double ops = double(FRAMES) * TRIANGLES;
+
+    Record(name, Layout(), std::chrono::duration<double, std::nano>(end - start).count() / ops, (Allocations() - allocs) / ops);
+}
+
+// Small triangles touch few pixels on many rows, which a linear framebuffer keeps a whole screen width apart; the
+// larger the screen, the more that costs
+void RunRasterAll()
+{
+    std::mt19937 rng(42);
+
+    const struct { const char* name; int width, height; } resolutions[] = {{"480p", 640, 480}, {"1080p", 1920, 1080}, {"2160p", 3840, 2160}};
+
+    for (const auto& r : resolutions)
+    {
+        const std::string res = r.name;
+
+        RunRaster("raster " + res + " small", r.width, r.height, 16, 0, rng);
+        RunRaster("raster " + res + " large", r.width, r.height, 256, 0, rng);
+        RunRaster("raster " + res + " small (binned)", r.width, r.height, 16, 1, rng);
+    }
+}
+
+const char* Kernels()
+{
+#if defined(MYGL_AVX2)
+    return "AVX2";
+#elif defined(MYGL_AVX)
+    return "AVX";
+#elif defined(MYGL_SSE2)
+    return "SSE2";
+#else
+    return "scalar";
+#endif
+}
+
+void PrintCSV()
+{
+    std::cout << "name,type,ns_per_op,allocs_per_op,mops_per_s,kernels,bounds_checks,raster_kernel\n";
+
+    for (const Result& r : results)
+    {
+        std::cout << '"' << r.name << "\"," << r.type << ',' << r.ns << ',' << r.allocs << ',' << 1e3 / r.ns << ','
+                  << Kernels() << ',' << (MYGL_BOUNDS_CHECK ? "on" : "off") << ',' << GetRasterKernelName() << '\n';
+    }
+}
+
+void PrintJSON()
+{
+    std::cout << "{\n";
+    std::cout << "  \"kernels\": \"" << Kernels() << "\",\n";
+    std::cout << "  \"bounds_checks\": " << (MYGL_BOUNDS_CHECK ? "true" : "false") << ",\n";
+    std::cout << "  \"raster_kernel\": \"" << GetRasterKernelName() << "\",\n";
+    std::cout << "  \"framebuffer\": \"" << Layout() << "\",\n";
+    std::cout << "  \"results\": [\n";
+
+    for (size_t i = 0; i < results.size(); ++i)
+    {
+        const Result& r = results[i];
+
+        std::cout << "    { \"name\": \"" << r.name << "\", \"type\": \"" << r.type << "\", \"ns_per_op\": " << r.ns
+                  << ", \"allocs_per_op\": " << r.allocs << ", \"mops_per_s\": " << 1e3 / r.ns << " }"
+                  << (i + 1 < results.size() ? ",\n" : "\n");
+    }
+
+    std::cout << "  ]\n}\n";
+}
+
+int main(int argc, char* argv[])
+{
+    for (int i = 1; i < argc; ++i)
+    {
+        if (std::strcmp(argv[i], "--csv") == 0) format = Format::CSV;
+        else if (std::strcmp(argv[i], "--json") == 0) format = Format::JSON;
+        else filter = argv[i];
+    }
+
+    if (format == Format::TABLE)
+    {
+        std::cout << "kernels: " << Kernels() << "\n";
+        std::cout << "bounds checks: " << (MYGL_BOUNDS_CHECK ? "on" : "off") << "\n";
+        std::cout << "raster kernel: " << GetRasterKernelName() << "\n";
+        std::cout << "framebuffer: " << Layout() << "\n";
+    }
+
+    RunAll<float>();
+    RunAll<double>();
+    RunRasterAll();
+
+    std::cout << std::fixed << std::setprecision(4);
+
+    if (format == Format::CSV) PrintCSV();
+    else if (format == Format::JSON) PrintJSON();
+
+    return 0;
+}
@@ -0,0 +1,101 @@
+/* g++ bintest.cpp -o bintest -std=c++14 -O2 -pthread */
+/* build again with -DMYGL_TILED_FRAMEBUFFER and -DMYGL_NO_SIMD for the other layout and kernels */
+
+/*
+    Draws the same frames of random triangles, lines and single pixels with every triangle drawn right away and with the
+    triangles binned on 1 to 4 threads, and checks that the frames come out the same. The pixels are written between
+    triangles, without a depth test, so a binned triangle that is drawn after a pixel that was submitted later shows.
+*/
+
+#include <iostream>
+#include <random>
+#include <vector>
+
+#include "mygl.h"
+
+using namespace mygl;
+
+const int WIDTH = 300;
+const int HEIGHT = 200;
+const int FRAMES = 4;
+const int TRIANGLES = 500;
+
+struct NoDepth : DepthColourWrite
+{
+    static constexpr bool DEPTH_TEST = false;
+    static constexpr bool DEPTH_WRITE = false;
+};
+
+class BinTest : public RendererBase3D
+{
+public:
+    BinTest(unsigned seed) : RendererBase3D(WIDTH, HEIGHT), rng(seed) {}
+
+    void Init() {}
+    void Update() {}
+
+    void Render()
+    {
+        std::uniform_real_distribution<float> x(-20, WIDTH + 20), y(-20, HEIGHT + 20), z(1, 100);
+        std::uniform_int_distribution<int> c(0, 255), px(0, WIDTH - 1), py(0, HEIGHT - 1), what(0, 9);
+
+        for (int i = 0; i < TRIANGLES; ++i)
+        {
+            Colour colour(c(rng), c(rng), c(rng), 255);
+
+            switch (what(rng))
+            {
+            case 0:
+                PutPixel(px(rng), py(rng), 1.0f / z(rng), colour.argb, NoDepth());
+                break;
+            case 1:
+                DrawLine(vec3f(x(rng), y(rng), z(rng)), vec3f(x(rng), y(rng), z(rng)), colour);
+                break;
+            default:
+                DrawFilledTriangleBarycentric(vec3f(x(rng), y(rng), z(rng)), vec3f(x(rng), y(rng), z(rng)),
+                                              vec3f(x(rng), y(rng), z(rng)), colour);
+                break;
+            }
+        }
+    }
+
+    std::vector<uint32_t> Frame()
+    {
+        ClearScreen();
+        Render();
+
+        const uint32_t* frame = Present();
+        return std::vector<uint32_t>(frame, frame + WIDTH * HEIGHT);
+    }
+private:
+    std::mt19937 rng;
+};
+
+int main()
+{
+    int failed = 0;
+
+    for (int threads = 1; threads <= 4; ++threads)
+    {
+        BinTest serial(threads);
+        BinTest binned(threads);
+
+        binned.SetRasterThreads(threads);
+
+        for (int frame = 0; frame < FRAMES; ++frame)
+        {
+            std::vector<uint32_t> expected = serial.Frame();
+            std::vector<uint32_t> actual = binned.Frame();
+
+            if (expected != actual)
+            {
+                std::cout << "frame " << frame << " differs with " << threads << " threads" << std::endl;
+                ++failed;
+            }
+        }
+    }
+
+    std::cout << (failed ? "FAILED" : "OK") << std::endl;
+
+    return failed ? 1 : 0;
+}
@@ -0,0 +1,506 @@
+/* g++ headless.cpp -o headless -std=c++14 -O2 -march=native -pthread */
+/* build again with -DMYGL_FRAME_STATS for the renderer's counters and stage times, with -DMYGL_PROFILE for --trace */
+/* and with -DMYGL_ALLOC_STATS for the heap allocations and --allocs and --alloc-budget */
+
+/*
+    Usage: headless [options]
+
+        --scene poggers|rubik   what to render (poggers)
+        --frames N              how many frames (600)
+        --size WxH              screen size in pixels (600x600)
+        --threads N             SetRasterThreads, 0 draws every triangle right away (0)
+        --out none|ppm|raw      discard the frames or write each to a file, raw being the BGRA values as Present returns
+                                them (none)
+        --dir PATH              where the frames are written (.)
+        --seed N                for the Rubik scrambles (1)
+        --stats PATH            with MYGL_FRAME_STATS, also write every frame's FrameStats to PATH as CSV
+        --trace PATH            with MYGL_PROFILE, write the profile zones to PATH as a Chrome trace once the frames are
+                                done; only the last of them fit if there are many
+        --allocs PATH           with MYGL_ALLOC_STATS, also write every frame's allocations to PATH as CSV
+        --alloc-budget N        with MYGL_ALLOC_STATS, fail if Render allocates more than N times in a frame once the
+                                first ALLOC_WARMUP frames are done; --frames must be more than ALLOC_WARMUP
+
+    The options that need a build with MYGL_FRAME_STATS, MYGL_PROFILE or MYGL_ALLOC_STATS are errors without it.
+
+    Renders a scene without a window: Init, then Update, ClearScreen, Render and Present once per frame, as the window
+    hosts do on every timer tick. Prints frames/sec, the frame time percentiles and triangles/sec, where a frame is
+    timed from Update to Present and writing it out is not counted. The poggers cube is dragged around by a simulated
+    arcball and the Rubik cube is scrambled over and over, so that every frame is different. Built with
+    MYGL_FRAME_STATS, it also prints the renderer's counters and stage times averaged over the frames. Built with
+    MYGL_PROFILE, every frame is a zone of the trace, with the scene's and the renderer's zones inside. Built with
+    MYGL_ALLOC_STATS, it prints the heap allocations per frame by category, and Render's on their own, and with
+    --alloc-budget the exit status is 1 if a frame of Render went over the budget, so that it can serve as a test.
+*/
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <vector>
+
+#include "poggers.h"
+#include "rubik.h"
+
+using namespace mygl;
+
+enum class Output { NONE, PPM, RAW };
+
+const int ALLOC_WARMUP = 10; // frames that may allocate while the scene and the renderer grow their arrays
+
+struct Options
+{
+    std::string scene = "poggers";
+    int frames = 600;
+    int width = 600;
+    int height = 600;
+    int threads = 0;
+    Output out = Output::NONE;
+    std::string dir = ".";
+    unsigned seed = 1;
+    std::string stats;
+    std::string trace;
+    std::string allocs;
+    int allocBudget = -1; // none
+};
+
+// Drags the arcball in a circle around the centre of the screen
+class HeadlessPoggers : public poggers::Poggers
+{
+public:
+    HeadlessPoggers(int width, int height) : Poggers(width, height) {}
+
+    void Init()
+    {
+        Poggers::Init();
+        HandleMousePress(width / 2, height / 2);
+    }
+
+    void Update()
+    {
+        Poggers::Update();
+
+        float t = 0.05f * frame++;
+        float r = 0.25f * std::min(width, height);
+
+        HandleMouseMotion(int(width / 2 + r * std::cos(t)), int(height / 2 + r * std::sin(t)));
+    }
+private:
+    int frame = 0;
+};
+
+// Updates only while a move is animated, as the window does with its timer, and starts another scramble as soon as one
+// is done
+class HeadlessRubik : public rubik::Rubik
+{
+public:
+    HeadlessRubik(int width, int height) : Rubik(width, height) {}
+
+    void Update()
+    {
+        if (!animating)
+        {
+            StartScramble();
+        }
+
+        Rubik::Update();
+    }
+protected:
+    void StartAnimation() { animating = true; }
+    void StopAnimation() { animating = false; }
+private:
+    bool animating = false;
+};
+
+// A scene with what a window host would do on every timer tick
+template<typename Scene>
+class Offscreen : public Scene
+{
+public:
+    Offscreen(int width, int height) : Scene(width, height) {}
+
+    const uint32_t* Frame()
+    {
+        MYGL_PROFILE_ZONE("Frame");
+
+        ResetAllocPeaks();
+        AllocStats start = GetAllocStats();
+
+        this->Update();
+        this->ClearScreen();
+
+        AllocStats beforeRender = GetAllocStats();
+
+        this->Render();
+
+        renderAllocs = GetAllocStatsSince(beforeRender);
+
+        const uint32_t* pixels = this->Present();
+
+        frameAllocs = GetAllocStatsSince(start);
+
+        return pixels;
+    }
+
+    // Only with MYGL_ALLOC_STATS: the heap allocations of the last frame, and of its Render
+    const AllocStats& FrameAllocs() const { return frameAllocs; }
+    const AllocStats& RenderAllocs() const { return renderAllocs; }
+private:
+    AllocStats frameAllocs;
+    AllocStats renderAllocs;
+};
+
+bool WriteFrame(const Options& options, int frame, const uint32_t* pixels)
+{
+    char name[64];
+    std::snprintf(name, sizeof(name), "/%s_%05d.%s", options.scene.c_str(), frame, options.out == Output::PPM ? "ppm" : "raw");
+
+    std::string path = options.dir + name;
+    FILE* fp = std::fopen(path.c_str(), "wb");
+
+    if (fp == NULL)
+    {
+        std::cerr << "Couldn't open " << path << "\n";
+        return false;
+    }
+
+    int n = options.width * options.height;
+
+    if (options.out == Output::PPM)
+    {
+        std::vector<unsigned char> rgb(3 * n);
+
+        for (int i = 0; i < n; ++i)
+        {
+            rgb[3 * i] = (pixels[i] >> 16) & 0xff;
+            rgb[3 * i + 1] = (pixels[i] >> 8) & 0xff;
+            rgb[3 * i + 2] = pixels[i] & 0xff;
+        }
+
+        std::fprintf(fp, "P6\n%d %d\n255\n", options.width, options.height);
+        std::fwrite(rgb.data(), 1, rgb.size(), fp);
+    }
+    else
+    {
+        std::fwrite(pixels, sizeof(uint32_t), n, fp);
+    }
+
+    bool ok = !std::ferror(fp);
+
+    std::fclose(fp);
+
+    if (!ok)
+    {
+        std::cerr << "Couldn't write " << path << "\n";
+    }
+
+    return ok;
+}
+
+void AddStats(FrameStats& sum, const FrameStats& stats)
+{
+    sum.submitted += stats.submitted;
+    sum.culled += stats.culled;
+    sum.clipped += stats.clipped;
+    sum.rasterized += stats.rasterized;
+    sum.tested += stats.tested;
+    sum.rejected += stats.rejected;
+    sum.written += stats.written;
+    sum.overdraw += stats.overdraw;
+    sum.clearMs += stats.clearMs;
+    sum.vertexMs += stats.vertexMs;
+    sum.rasterMs += stats.rasterMs;
+    sum.presentMs += stats.presentMs;
+}
+
+void AddAllocs(AllocStats& sum, const AllocStats& allocs)
+{
+    for (int i = 0; i < ALLOC_CATEGORIES; ++i)
+    {
+        sum.counts[i].allocations += allocs.counts[i].allocations;
+        sum.counts[i].bytes += allocs.counts[i].bytes;
+        sum.counts[i].peak = std::max(sum.counts[i].peak, allocs.counts[i].peak);
+    }
+}
+
+void WriteAllocs(std::ostream& out, int frame, const AllocStats& frameAllocs, const AllocStats& renderAllocs)
+{
+    out << frame;
+
+    for (const AllocCounts& c : frameAllocs.counts)
+    {
+        out << ',' << c.allocations << ',' << c.bytes << ',' << c.peak;
+    }
+
+    out << ',' << renderAllocs.Total().allocations << ',' << renderAllocs.Total().bytes << '\n';
+}
+
+void WriteStats(std::ostream& out, int frame, const FrameStats& stats)
+{
+    out << frame << ',' << stats.submitted << ',' << stats.culled << ',' << stats.clipped << ',' << stats.rasterized << ','
+        << stats.tested << ',' << stats.rejected << ',' << stats.written << ',' << stats.overdraw << ','
+        << stats.clearMs << ',' << stats.vertexMs << ',' << stats.rasterMs << ',' << stats.presentMs << '\n';
+}
+
+template<typename Scene>
+int Run(const Options& options)
+{
+    Offscreen<Scene> scene(options.width, options.height);
+
+    scene.SetRasterThreads(options.threads);
+    scene.Init();
+
+    std::srand(options.seed); // after Init, which seeds with the time
+
+    std::vector<double> ms(options.frames);
+    double triangles = 0;
+
+    FrameStats sum;
+    std::ofstream statsFile;
+
+    if (FRAME_STATS && !options.stats.empty())
+    {
+        statsFile.open(options.stats);
+
+        if (!statsFile)
+        {
+            std::cerr << "Couldn't open " << options.stats << "\n";
+            return 1;
+        }
+
+        statsFile << "frame,submitted,culled,clipped,rasterized,tested,rejected,written,overdraw,clear_ms,vertex_ms,raster_ms,present_ms\n";
+    }
+
+    AllocStats allocSum;
+    int64_t renderAllocsMax = 0;
+    int overBudget = 0;
+    std::ofstream allocsFile;
+
+    if (ALLOC_STATS && !options.allocs.empty())
+    {
+        allocsFile.open(options.allocs);
+
+        if (!allocsFile)
+        {
+            std::cerr << "Couldn't open " << options.allocs << "\n";
+            return 1;
+        }
+
+        allocsFile << "frame";
+
+        for (int i = 0; i < ALLOC_CATEGORIES; ++i)
+        {
+            const char* name = AllocCategoryName(AllocCategory(i));
+
+            allocsFile << ',' << name << "_allocations," << name << "_bytes," << name << "_peak";
+        }
+
+        allocsFile << ",render_allocations,render_bytes\n";
+    }
+
+    MYGL_PROFILE_THREAD("main");
+
+    auto start = std::chrono::steady_clock::now();
+
+    for (int i = 0; i < options.frames; ++i)
+    {
+        auto begin = std::chrono::steady_clock::now();
+        const uint32_t* pixels = scene.Frame();
+        auto end = std::chrono::steady_clock::now();
+
+        ms[i] = std::chrono::duration<double, std::milli>(end - begin).count();
+        triangles += scene.TrianglesDrawn();
+
+        if (FRAME_STATS)
+        {
+            AddStats(sum, scene.GetFrameStats());
+
+            if (statsFile.is_open()) WriteStats(statsFile, i, scene.GetFrameStats());
+        }
+
+        if (ALLOC_STATS)
+        {
+            AddAllocs(allocSum, scene.FrameAllocs());
+
+            if (allocsFile.is_open()) WriteAllocs(allocsFile, i, scene.FrameAllocs(), scene.RenderAllocs());
+
+            int64_t renderAllocs = scene.RenderAllocs().Total().allocations;
+
+            if (i >= ALLOC_WARMUP)
+            {
+                renderAllocsMax = std::max(renderAllocsMax, renderAllocs);
+
+                if (options.allocBudget >= 0 && renderAllocs > options.allocBudget)
+                {
+                    std::cerr << "frame " << i << ": Render allocated " << renderAllocs << " times, the budget is "
+                              << options.allocBudget << "\n";
+                    ++overBudget;
+                }
+            }
+        }
+
+        if (options.out != Output::NONE && !WriteFrame(options, i, pixels))
+        {
+            return 1;
+        }
+    }
+
+    double total = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    double rendering = 0;
+
+    for (double t : ms)
+    {
+        rendering += t / 1e3;
+    }
+
+    std::sort(ms.begin(), ms.end());
+
+    auto percentile = [&](double p) { return ms[std::min(options.frames - 1, int(p / 100 * options.frames))]; };
+
+    std::cout << "scene: " << options.scene << ", " << options.width << "x" << options.height << ", " << options.frames << " frames\n";
+    std::cout << "raster kernel: " << GetRasterKernelName() << ", framebuffer: " << (TILED_FRAMEBUFFER ? "tiled" : "linear")
+              << ", threads: " << options.threads << "\n";
+    std::cout << std::fixed << std::setprecision(1);
+    std::cout << "frames/sec: " << options.frames / rendering << " (" << options.frames / total << " with output)\n";
+    std::cout << std::setprecision(3);
+    std::cout << "frame ms: p50 " << percentile(50) << ", p90 " << percentile(90) << ", p99 " << percentile(99)
+              << ", max " << ms.back() << "\n";
+    std::cout << std::setprecision(0);
+    std::cout << "triangles/sec: " << triangles / rendering << " (" << triangles / options.frames << " per frame)\n";
+
+    if (FRAME_STATS)
+    {
+        double n = options.frames;
+
+        std::cout << std::setprecision(1);
+        std::cout << "per frame, triangles: " << sum.submitted / n << " submitted, " << sum.culled / n << " culled, "
+                  << sum.clipped / n << " clipped, " << sum.rasterized / n << " rasterized\n";
+        std::cout << std::setprecision(0);
+        std::cout << "per frame, pixels: " << sum.tested / n << " tested, " << sum.rejected / n << " rejected, "
+                  << sum.written / n << " written, overdraw " << std::setprecision(3) << sum.overdraw / n << "\n";
+        std::cout << "per frame, ms: " << sum.clearMs / n << " clear, " << sum.vertexMs / n << " vertex, "
+                  << sum.rasterMs / n << " raster, " << sum.presentMs / n << " present\n";
+    }
+
+    if (ALLOC_STATS)
+    {
+        double n = options.frames;
+
+        std::cout << std::setprecision(1);
+        std::cout << "per frame, allocations:";
+
+        for (int i = 0; i < ALLOC_CATEGORIES; ++i)
+        {
+            const AllocCounts& c = allocSum.counts[i];
+
+            std::cout << (i ? ", " : " ") << AllocCategoryName(AllocCategory(i)) << " " << c.allocations / n << " ("
+                      << c.bytes / n << " bytes, peak " << c.peak << ")";
+        }
+
+        std::cout << "\n";
+        std::cout << "Render allocations after " << ALLOC_WARMUP << " frames: at most " << renderAllocsMax << " per frame\n";
+    }
+
+    if (PROFILE && !options.trace.empty() && !WriteChromeTrace(options.trace.c_str()))
+    {
+        std::cerr << "Couldn't write " << options.trace << "\n";
+        return 1;
+    }
+
+    if (overBudget > 0)
+    {
+        std::cerr << overBudget << " frames went over the allocation budget\n";
+        return 1;
+    }
+
+    return 0;
+}
+
+int main(int argc, char* argv[])
+{
+    Options options;
+
+    for (int i = 1; i < argc; ++i)
+    {
+        const char* arg = argv[i];
+        const char* value = i + 1 < argc ? argv[i + 1] : NULL;
+
+        if (value == NULL)
+        {
+            std::cerr << "Missing value for " << arg << "\n";
+            return 1;
+        }
+
+        if (std::strcmp(arg, "--scene") == 0) options.scene = value;
+        else if (std::strcmp(arg, "--frames") == 0) options.frames = std::atoi(value);
+        else if (std::strcmp(arg, "--size") == 0)
+        {
+            char end;
+
+            if (std::sscanf(value, "%dx%d%c", &options.width, &options.height, &end) != 2)
+            {
+                std::cerr << "Bad size " << value << "\n";
+                return 1;
+            }
+        }
+        else if (std::strcmp(arg, "--threads") == 0) options.threads = std::atoi(value);
+        else if (std::strcmp(arg, "--dir") == 0) options.dir = value;
+        else if (std::strcmp(arg, "--seed") == 0) options.seed = unsigned(std::atoi(value));
+        else if (std::strcmp(arg, "--stats") == 0) options.stats = value;
+        else if (std::strcmp(arg, "--trace") == 0) options.trace = value;
+        else if (std::strcmp(arg, "--allocs") == 0) options.allocs = value;
+        else if (std::strcmp(arg, "--alloc-budget") == 0) options.allocBudget = std::atoi(value);
+        else if (std::strcmp(arg, "--out") == 0)
+        {
+            if (std::strcmp(value, "none") == 0) options.out = Output::NONE;
+            else if (std::strcmp(value, "ppm") == 0) options.out = Output::PPM;
+            else if (std::strcmp(value, "raw") == 0) options.out = Output::RAW;
+            else
+            {
+                std::cerr << "Unknown output " << value << "\n";
+                return 1;
+            }
+        }
+        else
+        {
+            std::cerr << "Unknown option " << arg << "\n";
+            return 1;
+        }
+
+        ++i;
+    }
+
+    if (options.frames <= 0 || options.width <= 0 || options.height <= 0 || options.threads < 0)
+    {
+        std::cerr << "Bad frame count, size or thread count\n";
+        return 1;
+    }
+
+    // options that the build cannot honour are errors, so that eg. a budget check cannot pass without checking anything
+    const char* missing = !FRAME_STATS && !options.stats.empty() ? "--stats needs MYGL_FRAME_STATS" :
+                          !PROFILE && !options.trace.empty() ? "--trace needs MYGL_PROFILE" :
+                          !ALLOC_STATS && !options.allocs.empty() ? "--allocs needs MYGL_ALLOC_STATS" :
+                          !ALLOC_STATS && options.allocBudget >= 0 ? "--alloc-budget needs MYGL_ALLOC_STATS" : NULL;
+
+    if (missing != NULL)
+    {
+        std::cerr << missing << "\n";
+        return 1;
+    }
+
+    if (options.allocBudget >= 0 && options.frames <= ALLOC_WARMUP)
+    {
+        std::cerr << "--alloc-budget needs more than " << ALLOC_WARMUP << " frames\n";
+        return 1;
+    }
+
+    if (options.scene == "poggers") return Run<HeadlessPoggers>(options);
+    if (options.scene == "rubik") return Run<HeadlessRubik>(options);
+
+    std::cerr << "Unknown scene " << options.scene << "\n";
+    return 1;
+}
@@ -4,49 +4,134 @@
 #include <ostream>
 #include <stdexcept>
 #include <limits>
+#include <type_traits>
 
 #define _USE_MATH_DEFINES
 #include <cmath>
 
+#include "profile.h"
+
 namespace mygl
 {
     template<typename T, size_t N>              class Vector;
     template<typename T, size_t M, size_t N>    class Matrix;
     template<typename T>                        class Quaternion;
+    template<typename L, typename R>            class MatrixProduct;
 
     template <typename IntegralType>
-    typename std::enable_if<std::is_integral<IntegralType>::value, bool>::type IsEqual(const IntegralType& a, const IntegralType& b)
+    constexpr typename std::enable_if<std::is_integral<IntegralType>::value, bool>::type IsEqual(const IntegralType& a, const IntegralType& b)
     {
         return a == b;
     }
 
     template <typename FloatingType>
-    typename std::enable_if<std::is_floating_point<FloatingType>::value, bool>::type IsEqual(const FloatingType& a, const FloatingType& b)
+    constexpr typename std::enable_if<std::is_floating_point<FloatingType>::value, bool>::type IsEqual(const FloatingType& a, const FloatingType& b)
+    {
+        return a - b < std::numeric_limits<FloatingType>::epsilon() && b - a < std::numeric_limits<FloatingType>::epsilon(); // |a - b| < epsilon
+    }
+
+    /*
+        Element access policy
+
+        operator[] on vectors and matrices throws std::out_of_range on a bad index only when MYGL_BOUNDS_CHECK is
+        nonzero. It defaults to checked in debug builds and unchecked in release (NDEBUG) builds; define it as 0 or 1
+        to override. AtUnchecked() and Data() never check, and are what the library's own loops use so that they can
+        be vectorized regardless of the policy.
+    */
+#if !defined(MYGL_BOUNDS_CHECK)
+#if defined(NDEBUG)
+#define MYGL_BOUNDS_CHECK 0
+#else
+#define MYGL_BOUNDS_CHECK 1
+#endif
+#endif
+
+    constexpr void CheckIndex(int index, size_t size, const char* message)
     {
-        return std::fabs(a - b) < std::numeric_limits<FloatingType>::epsilon();
+#if MYGL_BOUNDS_CHECK
+        if (index < 0 || index >= int(size)) throw std::out_of_range(message);
+#else
+        (void)index, (void)size, (void)message;
+#endif
     }
 
+    // True if every type in the pack is arithmetic; keeps the variadic Vector constructor from hijacking conversions
+    template<typename ...Args> struct AllArithmetic : std::true_type {};
+    template<typename First, typename ...Rest> struct AllArithmetic<First, Rest...>
+        : std::integral_constant<bool, std::is_arithmetic<First>::value && AllArithmetic<Rest...>::value> {};
+
+    /*
+        Expression templates
+
+        Arithmetic on vectors and matrices does not compute anything by itself. Instead, each operator returns a
+        lightweight node describing the operation, and the whole tree is evaluated element by element in a single
+        loop once it is assigned to a Vector or Matrix. Every element is computed with exactly the same operations
+        (in the same order) as the old eager operators, so results are identical.
+
+        Lvalue vectors and matrices are held by reference; temporaries and nested nodes are held by value, so an
+        expression stored in an auto variable never refers to a destroyed temporary.
+    */
+    template<typename E>
+    class VectorExpr
+    {
+    public:
+        const E& Derived() const { return static_cast<const E&>(*this); }
+
+        // Nodes only implement AtUnchecked(); Vector and MatrixRow hide this with their own operator[]
+        auto operator[](int index) const
+        {
+            CheckIndex(index, E::dimensions, "index is out of bounds");
+            return Derived().AtUnchecked(index);
+        }
+    };
+
+    template<typename E>
+    struct IsVectorExpr : std::is_base_of<VectorExpr<typename std::decay<E>::type>, typename std::decay<E>::type> {};
+
+    template<typename E> struct IsVector : std::false_type {};
+    template<typename T, size_t N> struct IsVector<Vector<T, N>> : std::true_type {};
+
+    template<typename E>
+    using VectorOperand = typename std::conditional<std::is_lvalue_reference<E>::value && IsVector<typename std::decay<E>::type>::value,
+                                                    const typename std::decay<E>::type&,
+                                                    typename std::decay<E>::type>::type;
+
+    struct AddOp      { template<typename T> static T Apply(T a, T b) { return a + b; } };
+    struct SubtractOp { template<typename T> static T Apply(T a, T b) { return a - b; } };
+    struct MultiplyOp { template<typename T> static T Apply(T a, T b) { return a * b; } };
+    struct DivideOp   { template<typename T> static T Apply(T a, T b) { return a / b; } };
+
+    // Blocks whose size is a multiple of 16 bytes (vec4f, mat4f, ...) are 16-byte aligned so SIMD loads never split a cache line
     template<typename T, size_t N>
-    class Vector
+    struct StorageAlignment : std::integral_constant<size_t, (sizeof(T) * N) % 16 == 0 ? 16 : alignof(T)> {};
+
+    template<typename T, size_t N>
+    class Vector : public VectorExpr<Vector<T, N>>
     {
     public:
-        Vector() { _init_data(); }
-        Vector(std::initializer_list<T> l);
-        template<typename ...Args> Vector(Args... args) : Vector({args...}) {}
-        Vector(const Vector& v);
-        ~Vector() { delete[] a; }
+        using value_type = T;
+        static constexpr size_t dimensions = N;
 
-        bool operator==(const Vector& v) const;
+        constexpr Vector() : a{} {}
+        template<typename ...Args, typename = typename std::enable_if<AllArithmetic<Args...>::value>::type> constexpr Vector(Args... args);
+        Vector(const Vector& v) = default;
+        template<typename E> Vector(const VectorExpr<E>& e) { *this = e; }
 
-        Vector& operator=(const Vector& v);
-        Vector& operator+=(const Vector& v);
-        Vector& operator-=(const Vector& v);
-        Vector& operator*=(T s);
-        T operator*=(const Vector& v) const;
-        Vector& operator/=(T s);
+        constexpr bool operator==(const Vector& v) const;
 
-        T operator[](int index) const;
-        T& operator[](int index);
+        Vector& operator=(const Vector& v) = default;
+        template<typename E> Vector& operator=(const VectorExpr<E>& e);
+        constexpr Vector& operator+=(const Vector& v);
+        constexpr Vector& operator-=(const Vector& v);
+        constexpr Vector& operator*=(T s);
+        constexpr T operator*=(const Vector& v) const;
+        constexpr Vector& operator/=(T s);
+
+        constexpr T operator[](int index) const;
+        constexpr T& operator[](int index);
+
+        constexpr T AtUnchecked(int index) const { return a[index]; }
+        constexpr T& AtUnchecked(int index) { return a[index]; }
 
         Vector Unit() const;
 
@@ -59,89 +144,77 @@ namespace mygl
         Vector Project(const Vector& v) const;
 
         // Reduce the dimension of this vector
-        Vector<T, N - 1> Demote() const;
+        constexpr Vector<T, N - 1> Demote() const;
 
-        size_t Dimensions() const { return N; }
-    private:
-        T* a;
+        // Raw access to the N contiguous components
+        constexpr const T* Data() const { return a; }
+        constexpr T* Data() { return a; }
 
-        void _init_data();
+        constexpr size_t Dimensions() const { return N; }
+    private:
+        alignas(StorageAlignment<T, N>::value) T a[N]; // components are stored inline so that vectors are trivially copyable
     };
 
     template<typename T, size_t N>
-    Vector<T, N>::Vector(std::initializer_list<T> l)
+    template<typename ...Args, typename>
+    constexpr Vector<T, N>::Vector(Args... args) : a{static_cast<T>(args)...}
     {
-        if (l.size() != N)
-        {
-            throw std::length_error("wrong number of arguments");
-        }
-
-        _init_data();
-
-        int i = 0;
-
-        for (auto elem : l)
-        {
-            a[i++] = elem;
-        }
+        static_assert(sizeof...(Args) == N, "wrong number of arguments");
     }
 
     template<typename T, size_t N>
-    Vector<T, N>::Vector(const Vector<T, N>& v)
+    template<typename E>
+    Vector<T, N>& Vector<T, N>::operator=(const VectorExpr<E>& e)
     {
-        _init_data();
-        *this = v;
-    }
+        static_assert(E::dimensions == N, "vector dimensions do not match");
 
-    template<typename T, size_t N>
-    bool Vector<T, N>::operator==(const Vector<T, N>& v) const
-    {
+        // every node is element-wise, so evaluating in place is safe even if e refers to this vector
         for (int i = 0; i < N; ++i)
         {
-            if (!IsEqual<T>(a[i], v[i]))
-            {
-                return false;
-            }
+            a[i] = e.Derived().AtUnchecked(i);
         }
 
-        return true;
+        return *this;
     }
 
     template<typename T, size_t N>
-    Vector<T, N>& Vector<T, N>::operator=(const Vector<T, N>& v)
+    constexpr bool Vector<T, N>::operator==(const Vector<T, N>& v) const
     {
         for (int i = 0; i < N; ++i)
         {
-            a[i] = v[i];
+            if (!IsEqual<T>(a[i], v.a[i]))
+            {
+                return false;
+            }
         }
 
-        return *this;
+        return true;
     }
 
     template<typename T, size_t N>
-    Vector<T, N>& Vector<T, N>::operator+=(const Vector<T, N>& v)
+    constexpr Vector<T, N>& Vector<T, N>::operator+=(const Vector<T, N>& v)
     {
         for (int i = 0; i < N; ++i)
         {
-            a[i] += v[i];
+            a[i] += v.a[i];
         }
 
         return *this;
     }
 
     template<typename T, size_t N>
-    Vector<T, N>& Vector<T, N>::operator-=(const Vector<T, N>& v)
+    constexpr Vector<T, N>& Vector<T, N>::operator-=(const Vector<T, N>& v)
     {
         for (int i = 0; i < N; ++i)
         {
-            a[i] -= v[i];
+            a[i] -= v.a[i];
         }
 
         return *this;
     }
 
     template<typename T, size_t N>
-    Vector<T, N>& Vector<T, N>::operator*=(T s)
+    constexpr Vector<T, N>& Vector<T, N>::operator*=(T s)
     {
         for (int i = 0; i < N; ++i)
         {
@@ -152,20 +225,20 @@ namespace mygl
     }
 
     template<typename T, size_t N>
-    T Vector<T, N>::operator*=(const Vector<T, N>& v) const
+    constexpr T Vector<T, N>::operator*=(const Vector<T, N>& v) const
     {
         T total = 0;
 
         for (int i = 0; i < N; ++i)
         {
-            total += a[i] * v[i];
+            total += a[i] * v.a[i];
         }
 
         return total;
     }
 
     template<typename T, size_t N>
-    Vector<T, N>& Vector<T, N>::operator/=(T s)
+    constexpr Vector<T, N>& Vector<T, N>::operator/=(T s)
     {
         if (IsEqual<T>(s, 0))
         {
@@ -182,17 +255,17 @@ namespace mygl
     }
 
     template<typename T, size_t N>
-    T Vector<T, N>::operator[](int index) const
+    constexpr T Vector<T, N>::operator[](int index) const
     {
-        if (index < 0 || index >= N) throw std::out_of_range("index is out of bounds");
-        else return a[index];
+        CheckIndex(index, N, "index is out of bounds");
+        return a[index];
     }
 
     template<typename T, size_t N>
-    T& Vector<T, N>::operator[](int index)
+    constexpr T& Vector<T, N>::operator[](int index)
     {
-        if (index < 0 || index >= N) throw std::out_of_range("index is out of bounds");
-        else return a[index];
+        CheckIndex(index, N, "index is out of bounds");
+        return a[index];
     }
 
     /* TODO division by zero? */
@@ -221,42 +294,122 @@ namespace mygl
     }
 
     template<typename T, size_t N>
-    Vector<T, N - 1> Vector<T, N>::Demote() const
+    constexpr Vector<T, N - 1> Vector<T, N>::Demote() const
     {
-        return Vector<T, N - 1>(a[0], a[1], a[2]);
+        Vector<T, N - 1> d;
+
+        for (int i = 0; i < N - 1; ++i)
+        {
+            d.AtUnchecked(i) = a[i];
+        }
+
+        return d;
     }
 
-    template<typename T, size_t N>
-    void Vector<T, N>::_init_data()
+    template<typename L, typename R, typename Op>
+    class VectorBinaryExpr : public VectorExpr<VectorBinaryExpr<L, R, Op>>
     {
-        a = new T[N];
+    public:
+        using value_type = typename std::decay<L>::type::value_type;
+        static constexpr size_t dimensions = std::decay<L>::type::dimensions;
 
-        for (int i = 0; i < N; ++i)
-        {
-            a[i] = 0;
-        }
+        static_assert(std::is_same<value_type, typename std::decay<R>::type::value_type>::value, "vector element types do not match");
+        static_assert(dimensions == std::decay<R>::type::dimensions, "vector dimensions do not match");
+
+        VectorBinaryExpr(L&& l, R&& r) : l_(std::forward<L>(l)), r_(std::forward<R>(r)) {}
+
+        value_type AtUnchecked(int index) const { return Op::Apply(value_type(l_.AtUnchecked(index)), value_type(r_.AtUnchecked(index))); }
+    private:
+        VectorOperand<L> l_;
+        VectorOperand<R> r_;
+    };
+
+    template<typename E, typename Op>
+    class VectorScalarExpr : public VectorExpr<VectorScalarExpr<E, Op>>
+    {
+    public:
+        using value_type = typename std::decay<E>::type::value_type;
+        static constexpr size_t dimensions = std::decay<E>::type::dimensions;
+
+        VectorScalarExpr(E&& e, value_type s) : e_(std::forward<E>(e)), s_(s) {}
+
+        value_type AtUnchecked(int index) const { return Op::Apply(value_type(e_.AtUnchecked(index)), s_); }
+    private:
+        VectorOperand<E> e_;
+        value_type s_;
+    };
+
+    template<typename E>
+    class VectorNegateExpr : public VectorExpr<VectorNegateExpr<E>>
+    {
+    public:
+        using value_type = typename std::decay<E>::type::value_type;
+        static constexpr size_t dimensions = std::decay<E>::type::dimensions;
+
+        explicit VectorNegateExpr(E&& e) : e_(std::forward<E>(e)) {}
+
+        value_type AtUnchecked(int index) const { return value_type(0) - value_type(e_.AtUnchecked(index)); }
+    private:
+        VectorOperand<E> e_;
+    };
+
+    // Evaluate a vector expression into a concrete vector
+    template<typename E>
+    Vector<typename E::value_type, E::dimensions> Eval(const VectorExpr<E>& e)
+    {
+        return Vector<typename E::value_type, E::dimensions>(e);
     }
 
-    template<typename T, size_t N> Vector<T, N> operator+(const Vector<T, N>& v) { return v; }
-    template<typename T, size_t N> Vector<T, N> operator-(const Vector<T, N>& v) { return Vector<T, N>() - v; }
+    template<typename E>
+    typename std::enable_if<IsVectorExpr<E>::value, typename std::decay<E>::type>::type operator+(E&& e) { return std::forward<E>(e); }
 
-    template<typename T, size_t N> Vector<T, N> operator+(Vector<T, N> l, const Vector<T, N>& r) { return l += r; }
-    template<typename T, size_t N> Vector<T, N> operator-(Vector<T, N> l, const Vector<T, N>& r) { return l -= r; }
+    template<typename E>
+    typename std::enable_if<IsVectorExpr<E>::value, VectorNegateExpr<E>>::type operator-(E&& e) { return VectorNegateExpr<E>(std::forward<E>(e)); }
 
-    template<typename T, typename U, size_t N> Vector<T, N> operator*(Vector<T, N> v, U s) { return v *= s; }
-    template<typename T, typename U, size_t N> Vector<T, N> operator*(U s, Vector<T, N> v) { return v *= s; }
-    template<typename T, size_t N> T operator*(Vector<T, N> a, Vector<T, N> b) { return a *= b; }
+    template<typename L, typename R>
+    typename std::enable_if<IsVectorExpr<L>::value && IsVectorExpr<R>::value, VectorBinaryExpr<L, R, AddOp>>::type operator+(L&& l, R&& r) { return VectorBinaryExpr<L, R, AddOp>(std::forward<L>(l), std::forward<R>(r)); }
 
-    template<typename T, typename U, size_t N> Vector<T, N> operator/(Vector<T, N> v, U s) { return v /= s; }
+    template<typename L, typename R>
+    typename std::enable_if<IsVectorExpr<L>::value && IsVectorExpr<R>::value, VectorBinaryExpr<L, R, SubtractOp>>::type operator-(L&& l, R&& r) { return VectorBinaryExpr<L, R, SubtractOp>(std::forward<L>(l), std::forward<R>(r)); }
 
-    template<typename T, size_t N>
-    std::ostream& operator<<(std::ostream& os, const Vector<T, N>& v)
+    template<typename E, typename U>
+    typename std::enable_if<IsVectorExpr<E>::value && std::is_arithmetic<U>::value, VectorScalarExpr<E, MultiplyOp>>::type operator*(E&& v, U s) { return VectorScalarExpr<E, MultiplyOp>(std::forward<E>(v), s); }
+
+    template<typename E, typename U>
+    typename std::enable_if<IsVectorExpr<E>::value && std::is_arithmetic<U>::value, VectorScalarExpr<E, MultiplyOp>>::type operator*(U s, E&& v) { return VectorScalarExpr<E, MultiplyOp>(std::forward<E>(v), s); }
+
+    // Dividing by zero leaves the vector unchanged (x / 1 == x exactly)
+    template<typename E, typename U>
+    typename std::enable_if<IsVectorExpr<E>::value && std::is_arithmetic<U>::value, VectorScalarExpr<E, DivideOp>>::type operator/(E&& v, U s)
+    {
+        using T = typename std::decay<E>::type::value_type;
+        return VectorScalarExpr<E, DivideOp>(std::forward<E>(v), IsEqual<T>(s, 0) ? T(1) : T(s));
+    }
+
+    // Dot product
+    template<typename L, typename R>
+    typename L::value_type operator*(const VectorExpr<L>& a, const VectorExpr<R>& b)
+    {
+        static_assert(L::dimensions == R::dimensions, "vector dimensions do not match");
+
+        typename L::value_type total = 0;
+
+        for (int i = 0; i < L::dimensions; ++i)
+        {
+            total += a.Derived().AtUnchecked(i) * b.Derived().AtUnchecked(i);
+        }
+
+        return total;
+    }
+
+    template<typename E>
+    std::ostream& operator<<(std::ostream& os, const VectorExpr<E>& v)
     {
         os << '[';
 
-        for (int i = 0; i < N; ++i)
+        for (int i = 0; i < E::dimensions; ++i)
         {
-            os << v[i] << ((i == N - 1) ? "]" : ", ");
+            os << v.Derived().AtUnchecked(i) << ((i == E::dimensions - 1) ? "]" : ", ");
         }
 
         return os;
@@ -272,9 +425,18 @@ namespace mygl
     using vec3d = Vector<double, 3>;
     using vec4d = Vector<double, 4>;
 
+    static_assert(std::is_trivially_copyable<vec4f>::value, "Vector must be trivially copyable");
+    static_assert(sizeof(vec4f) == 4 * sizeof(float), "Vector must not carry storage overhead");
+
     template<typename T> const Vector<T, 3> CrossProduct(const Vector<T, 3>& a, const Vector<T, 3>& b);
+    template<typename L, typename R> const Vector<typename L::value_type, 3> CrossProduct(const VectorExpr<L>& a, const VectorExpr<R>& b);
     template<typename T> const Vector<T, 3> Rotate3D(const Vector<T, 3>& v, const Quaternion<T>& q); // Rotate this vector about arbitrary axis and angle. Note that q must be a unit quaternion.
 
+    // Batched rotation of n points by unit quaternion q; out may alias in. Homogeneous points keep their w, and for
+    // SoA input w is neither read nor written (it may be null)
+    template<typename T> void Rotate3D(const Quaternion<T>& q, const Vector<T, 3>* in, Vector<T, 3>* out, size_t n);
+    template<typename T> void Rotate3D(const Quaternion<T>& q, const Vector<T, 4>* in, Vector<T, 4>* out, size_t n);
+
     template<typename T>
     const Vector<T, 3> CrossProduct(const Vector<T, 3>& a, const Vector<T, 3>& b)
     {
@@ -287,198 +449,295 @@ namespace mygl
         return c;
     }
 
+    template<typename L, typename R>
+    const Vector<typename L::value_type, 3> CrossProduct(const VectorExpr<L>& a, const VectorExpr<R>& b)
+    {
+        return CrossProduct<typename L::value_type>(Eval(a), Eval(b));
+    }
+
+    // Expands q * (0, v) * q^-1 for q = (s, u) into (s^2 - u.u) v + 2 (u.v) u + 2 s (u x v)
     template<typename T>
     const Vector<T, 3> Rotate3D(const Vector<T, 3>& v, const Quaternion<T>& q)
     {
-        Quaternion<T> p(0, v); // pure quaternion for v
+        T s = q.ScalarComponent();
+        Vector<T, 3> u = q.VectorComponent();
 
-        p = q * p * q.Conjugate(); // conjugate and inverse are the same in this case
+        T ux = u.AtUnchecked(0), uy = u.AtUnchecked(1), uz = u.AtUnchecked(2);
+        T vx = v.AtUnchecked(0), vy = v.AtUnchecked(1), vz = v.AtUnchecked(2);
 
-        return p.VectorComponent();
+        T a = s * s - (ux * ux + uy * uy + uz * uz);
+        T b = 2 * (ux * vx + uy * vy + uz * vz);
+        T c = 2 * s;
+
+        return Vector<T, 3>(a * vx + b * ux + c * (uy * vz - uz * vy),
+                            a * vy + b * uy + c * (uz * vx - ux * vz),
+                            a * vz + b * uz + c * (ux * vy - uy * vx));
     }
 
-    template<typename T, size_t M, size_t N>
-    class Matrix {
+    // Zero-copy view of a single matrix row; T is const-qualified for views into const matrices
+    template<typename T, size_t N>
+    class MatrixRow : public VectorExpr<MatrixRow<T, N>>
+    {
     public:
-        Matrix() { vecs_ = new Vector<T, N>[M]; }
-        Matrix(const Vector<T, N> vecs[]);
-        Matrix(std::initializer_list<std::initializer_list<T>> l);
-        Matrix(const Matrix& m);
-        ~Matrix() { delete[] vecs_; }
-
-        Matrix& operator=(const Matrix& m);
-        Matrix& operator+=(const Matrix& m);
-        Matrix& operator-=(const Matrix& m);
-        Matrix& operator*=(T c);
-        Matrix& operator/=(T c);
+        using value_type = typename std::remove_const<T>::type;
+        static constexpr size_t dimensions = N;
 
-        Vector<T, N> operator[](int row) const;
-        Vector<T, N>& operator[](int row);
+        constexpr explicit MatrixRow(T* row) : row_(row) {}
 
-        Vector<T, M> operator*(const Vector<T, N>& b) const;
-        template<size_t P> Matrix<T, M, P> operator*(const Matrix<T, N, P>& b) const;
+        constexpr MatrixRow& operator=(const Vector<value_type, N>& v);
 
-        Matrix<T, N, M> Transpose() const;
+        constexpr T& operator[](int index) const;
+        constexpr T& AtUnchecked(int index) const { return row_[index]; }
 
-        size_t Rows() const { return M; }
-        size_t Columns() const { return N; }
-    protected:
-        Vector<T, N>* vecs_;
+        constexpr size_t Dimensions() const { return N; }
+    private:
+        T* row_;
     };
 
-    template<typename T, size_t M, size_t N>
-    Matrix<T, M, N>::Matrix(const Vector<T, N> vecs[])
+    template<typename T, size_t N>
+    constexpr MatrixRow<T, N>& MatrixRow<T, N>::operator=(const Vector<value_type, N>& v)
     {
-        vecs_ = new Vector<T, N>[M];
-
-        for (int i = 0; i < M; ++i)
+        for (int i = 0; i < N; ++i)
         {
-            this->vecs_[i] = vecs[i];
+            row_[i] = v.AtUnchecked(i);
         }
+
+        return *this;
     }
 
-    template<typename T, size_t M, size_t N>
-    Matrix<T, M, N>::Matrix(std::initializer_list<std::initializer_list<T>> l)
+    template<typename T, size_t N>
+    constexpr T& MatrixRow<T, N>::operator[](int index) const
     {
-        if (l.size() != M)
-        {
-            throw std::out_of_range("row count does not match");
-        }
+        CheckIndex(index, N, "index is out of bounds");
+        return row_[index];
+    }
 
-        if (l.begin()->size() != N)
-        {
-            throw std::out_of_range("column count does not match");
-        }
+    template<typename E>
+    class MatrixExpr
+    {
+    public:
+        const E& Derived() const { return static_cast<const E&>(*this); }
+    };
+
+    template<typename E>
+    struct IsMatrixExpr : std::is_base_of<MatrixExpr<typename std::decay<E>::type>, typename std::decay<E>::type> {};
+
+    template<typename E> struct IsMatrix : std::false_type {};
+    template<typename T, size_t M, size_t N> struct IsMatrix<Matrix<T, M, N>> : std::true_type {};
+
+    template<typename E> struct IsMatrixProduct : std::false_type {};
+    template<typename L, typename R> struct IsMatrixProduct<MatrixProduct<L, R>> : std::true_type {};
 
-        vecs_ = new Vector<T, N>[M];
+    template<typename E>
+    struct IsMatrixLike : std::integral_constant<bool, IsMatrixExpr<E>::value || IsMatrixProduct<typename std::decay<E>::type>::value> {};
 
-        int i = 0, j = 0;
+    // Concrete matrix type that an expression evaluates to
+    template<typename E>
+    using MatrixResult = Matrix<typename std::decay<E>::type::value_type, std::decay<E>::type::rows, std::decay<E>::type::columns>;
 
-        for (auto row : l)
+    // Element-wise nodes keep nested element-wise nodes lazy, but evaluate products once up front
+    template<typename E>
+    using ElementwiseOperand = typename std::conditional<IsMatrixProduct<typename std::decay<E>::type>::value,
+                                                         MatrixResult<E>,
+                                                         typename std::conditional<std::is_lvalue_reference<E>::value && IsMatrix<typename std::decay<E>::type>::value,
+                                                                                   const typename std::decay<E>::type&,
+                                                                                   typename std::decay<E>::type>::type>::type;
+
+    // Products keep nested products lazy so that chains can be re-associated, but evaluate element-wise nodes up front
+    template<typename E>
+    using ProductOperand = typename std::conditional<std::is_lvalue_reference<E>::value && IsMatrix<typename std::decay<E>::type>::value,
+                                                     const typename std::decay<E>::type&,
+                                                     typename std::conditional<IsMatrix<typename std::decay<E>::type>::value || IsMatrixProduct<typename std::decay<E>::type>::value,
+                                                                               typename std::decay<E>::type,
+                                                                               MatrixResult<E>>::type>::type;
+
+    // Element storage of Matrix. It lives in a base class only so that Matrix can inherit a constructor taking its
+    // M rows as M separate parameters, which is what lets nested braces like {{1, 2}, {3, 4}} be checked at compile time
+    template<typename T, size_t M, size_t N, typename = std::make_index_sequence<M>>
+    class MatrixStorage;
+
+    template<typename T, size_t M, size_t N, size_t ...Rows>
+    class MatrixStorage<T, M, N, std::index_sequence<Rows...>>
+    {
+    private:
+        template<size_t> using Row = Vector<T, N>;
+    public:
+        constexpr MatrixStorage(const Row<Rows>&... rows);
+    protected:
+        struct Zeroed {};
+
+        MatrixStorage() = default; // elements are left uninitialized for constructors that overwrite all of them
+        constexpr explicit MatrixStorage(Zeroed) : elems_{} {}
+
+        alignas(StorageAlignment<T, M * N>::value) T elems_[M * N]; // row-major, element (i, j) lives at elems_[i * N + j]
+    };
+
+    template<typename T, size_t M, size_t N, size_t ...Rows>
+    constexpr MatrixStorage<T, M, N, std::index_sequence<Rows...>>::MatrixStorage(const Row<Rows>&... rows) : elems_{}
+    {
+        const Vector<T, N>* r[] = {&rows...};
+
+        for (int i = 0; i < M; ++i)
         {
-            for (auto elem : row)
+            for (int j = 0; j < N; ++j)
             {
-                vecs_[i][j++] = elem;
+                elems_[i * N + j] = r[i]->AtUnchecked(j);
             }
-
-            i++;
-            j = 0;
         }
     }
 
     template<typename T, size_t M, size_t N>
-    Matrix<T, M, N>::Matrix(const Matrix<T, M, N>& m)
-    {
-        vecs_ = new Vector<T, N>[M];
-        *this = m;
-    }
+    class Matrix : public MatrixExpr<Matrix<T, M, N>>, public MatrixStorage<T, M, N> {
+        using Storage = MatrixStorage<T, M, N>;
+    public:
+        using value_type = T;
+        static constexpr size_t rows = M;
+        static constexpr size_t columns = N;
+
+        using Storage::Storage; // Matrix(const Vector<T, N>& row0, ..., const Vector<T, N>& rowM-1)
+
+        constexpr Matrix() : Storage(typename Storage::Zeroed()) {}
+        Matrix(const Vector<T, N> vecs[]);
+        Matrix(const Matrix& m) = default;
+        template<typename E> Matrix(const MatrixExpr<E>& e) { *this = e; }
+        template<typename L, typename R> Matrix(const MatrixProduct<L, R>& p) : Matrix(p.Eval()) {}
+
+        Matrix& operator=(const Matrix& m) = default;
+        template<typename E> Matrix& operator=(const MatrixExpr<E>& e);
+        template<typename L, typename R> Matrix& operator=(const MatrixProduct<L, R>& p) { return *this = p.Eval(); }
+        constexpr Matrix& operator+=(const Matrix& m);
+        constexpr Matrix& operator-=(const Matrix& m);
+        constexpr Matrix& operator*=(T c);
+        constexpr Matrix& operator/=(T c);
+
+        constexpr MatrixRow<const T, N> operator[](int row) const;
+        constexpr MatrixRow<T, N> operator[](int row);
+
+        // Element at row-major index k (ie. row k / N, column k % N)
+        constexpr T Flat(int k) const { return elems_[k]; }
+        constexpr T& Flat(int k) { return elems_[k]; }
+
+        constexpr T AtUnchecked(int row, int column) const { return elems_[row * N + column]; }
+        constexpr T& AtUnchecked(int row, int column) { return elems_[row * N + column]; }
+
+        // Raw access to the M * N contiguous row-major elements
+        constexpr const T* Data() const { return elems_; }
+        constexpr T* Data() { return elems_; }
+
+        constexpr Matrix<T, N, M> Transpose() const;
+
+        constexpr size_t Rows() const { return M; }
+        constexpr size_t Columns() const { return N; }
+    protected:
+        template<typename, size_t, size_t> friend class Matrix;
+
+        using Storage::elems_;
+    };
 
     template<typename T, size_t M, size_t N>
-    Matrix<T, M, N>& Matrix<T, M, N>::operator=(const Matrix<T, M, N>& m)
+    Matrix<T, M, N>::Matrix(const Vector<T, N> vecs[])
     {
         for (int i = 0; i < M; ++i)
         {
             for (int j = 0; j < N; ++j)
             {
-                vecs_[i][j] = m[i][j];
+                elems_[i * N + j] = vecs[i].AtUnchecked(j);
             }
         }
+    }
+
+    template<typename T, size_t M, size_t N>
+    template<typename E>
+    Matrix<T, M, N>& Matrix<T, M, N>::operator=(const MatrixExpr<E>& e)
+    {
+        static_assert(E::rows == M && E::columns == N, "matrix dimensions do not match");
+
+        // every node is element-wise, so evaluating in place is safe even if e refers to this matrix
+        for (int k = 0; k < M * N; ++k)
+        {
+            elems_[k] = e.Derived().Flat(k);
+        }
+
         return *this;
     }
 
     template<typename T, size_t M, size_t N>
-    Matrix<T, M, N>& Matrix<T, M, N>::operator+=(const Matrix<T, M, N>& m)
+    constexpr Matrix<T, M, N>& Matrix<T, M, N>::operator+=(const Matrix<T, M, N>& m)
     {
-        for (int i = 0; i < M; ++i)
+        for (int i = 0; i < M * N; ++i)
         {
-            for (int j = 0; j < N; ++j)
-            {
-                vecs_[i][j] += m[i][j];
-            }
+            elems_[i] += m.elems_[i];
         }
         return *this;
     }
 
     template<typename T, size_t M, size_t N>
-    Matrix<T, M, N>& Matrix<T, M, N>::operator-=(const Matrix<T, M, N>& m)
+    constexpr Matrix<T, M, N>& Matrix<T, M, N>::operator-=(const Matrix<T, M, N>& m)
     {
-        for (int i = 0; i < M; ++i)
+        for (int i = 0; i < M * N; ++i)
         {
-            for (int j = 0; j < N; ++j)
-            {
-                vecs_[i][j] -= m[i][j];
-            }
+            elems_[i] -= m.elems_[i];
         }
         return *this;
     }
 
     template<typename T, size_t M, size_t N>
-    Matrix<T, M, N>& Matrix<T, M, N>::operator*=(T c)
+    constexpr Matrix<T, M, N>& Matrix<T, M, N>::operator*=(T c)
     {
-        for (int i = 0; i < M; ++i)
+        for (int i = 0; i < M * N; ++i)
         {
-            for (int j = 0; j < N; ++j)
-            {
-                vecs_[i][j] *= c;
-            }
+            elems_[i] *= c;
         }
         return *this;
     }
 
     template<typename T, size_t M, size_t N>
-    Matrix<T, M, N>& Matrix<T, M, N>::operator/=(T c)
+    constexpr Matrix<T, M, N>& Matrix<T, M, N>::operator/=(T c)
     {
         if (IsEqual<T>(c, 0))
         {
             throw std::logic_error("[matrix] division by zero");
         }
 
-        for (int i = 0; i < M; ++i)
+        for (int i = 0; i < M * N; ++i)
         {
-            for (int j = 0; j < N; ++j)
-            {
-                vecs_[i][j] /= c;
-            }
+            elems_[i] /= c;
         }
         return *this;
     }
 
     template<typename T, size_t M, size_t N>
-    Vector<T, N> Matrix<T, M, N>::operator[](int row) const
+    constexpr MatrixRow<const T, N> Matrix<T, M, N>::operator[](int row) const
     {
-        if (row < 0 || row >= M)
-        {
-            throw std::out_of_range("const Matrix subscript out of bounds");
-        }
-        return vecs_[row];
+        CheckIndex(row, M, "const Matrix subscript out of bounds");
+        return MatrixRow<const T, N>(elems_ + row * N);
     }
 
     template<typename T, size_t M, size_t N>
-    Vector<T, N>& Matrix<T, M, N>::operator[](int row)
+    constexpr MatrixRow<T, N> Matrix<T, M, N>::operator[](int row)
     {
-        if (row < 0 || row >= M)
-        {
-            throw std::out_of_range("const Matrix subscript out of bounds");
-        }
-        return vecs_[row];
+        CheckIndex(row, M, "Matrix subscript out of bounds");
+        return MatrixRow<T, N>(elems_ + row * N);
     }
 
     template<typename T, size_t M, size_t N>
-    Vector<T, M> Matrix<T, M, N>::operator*(const Vector<T, N>& b) const
+    constexpr Matrix<T, N, M> Matrix<T, M, N>::Transpose() const
     {
-        Vector<T, M> c;
+        Matrix<T, N, M> t;
 
         for (int i = 0; i < M; ++i)
         {
-            c[i] = vecs_[i] * b;
+            for (int j = 0; j < N; ++j)
+            {
+                t.elems_[j * M + i] = elems_[i * N + j];
+            }
         }
 
-        return c;
+        return t;
     }
 
-    template<typename T, size_t M, size_t N>
-    template <size_t P>
-    Matrix<T, M, P> Matrix<T, M, N>::operator*(const Matrix<T, N, P>& b) const
+    template<typename T, size_t M, size_t N, size_t P>
+    Matrix<T, M, P> Multiply(const Matrix<T, M, N>& a, const Matrix<T, N, P>& b)
     {
         Matrix<T, M, P> c;
 
@@ -488,7 +747,7 @@ namespace mygl
             {
                 for (int k = 0; k < N; ++k)
                 {
-                    c[i][j] += vecs_[i][k] * b[k][j];
+                    c.Flat(i * P + j) += a.Flat(i * N + k) * b.Flat(k * P + j);
                 }
             }
         }
@@ -497,31 +756,247 @@ namespace mygl
     }
 
     template<typename T, size_t M, size_t N>
-    Matrix<T, N, M> Matrix<T, M, N>::Transpose() const
+    Vector<T, M> Multiply(const Matrix<T, M, N>& a, const Vector<T, N>& b)
     {
-        Matrix<T, N, M> t;
+        Vector<T, M> c;
 
         for (int i = 0; i < M; ++i)
         {
-            for (int j = 0; j < N; ++j)
+            T total = 0;
+
+            for (int k = 0; k < N; ++k)
             {
-                t[j][i] = vecs_[i][j];
+                total += a.Flat(i * N + k) * b.AtUnchecked(k);
             }
+
+            c.AtUnchecked(i) = total;
         }
 
-        return t;
+        return c;
+    }
+
+    template<typename L, typename R, typename Op>
+    class MatrixBinaryExpr : public MatrixExpr<MatrixBinaryExpr<L, R, Op>>
+    {
+    public:
+        using value_type = typename std::decay<L>::type::value_type;
+        static constexpr size_t rows = std::decay<L>::type::rows;
+        static constexpr size_t columns = std::decay<L>::type::columns;
+
+        static_assert(std::is_same<value_type, typename std::decay<R>::type::value_type>::value, "matrix element types do not match");
+        static_assert(rows == std::decay<R>::type::rows && columns == std::decay<R>::type::columns, "matrix dimensions do not match");
+
+        MatrixBinaryExpr(L&& l, R&& r) : l_(std::forward<L>(l)), r_(std::forward<R>(r)) {}
+
+        value_type Flat(int k) const { return Op::Apply(l_.Flat(k), r_.Flat(k)); }
+    private:
+        ElementwiseOperand<L> l_;
+        ElementwiseOperand<R> r_;
+    };
+
+    template<typename E, typename Op>
+    class MatrixScalarExpr : public MatrixExpr<MatrixScalarExpr<E, Op>>
+    {
+    public:
+        using value_type = typename std::decay<E>::type::value_type;
+        static constexpr size_t rows = std::decay<E>::type::rows;
+        static constexpr size_t columns = std::decay<E>::type::columns;
+
+        MatrixScalarExpr(E&& e, value_type c) : e_(std::forward<E>(e)), c_(c) {}
+
+        value_type Flat(int k) const { return Op::Apply(e_.Flat(k), c_); }
+    private:
+        ElementwiseOperand<E> e_;
+        value_type c_;
+    };
+
+    template<typename E>
+    class MatrixNegateExpr : public MatrixExpr<MatrixNegateExpr<E>>
+    {
+    public:
+        using value_type = typename std::decay<E>::type::value_type;
+        static constexpr size_t rows = std::decay<E>::type::rows;
+        static constexpr size_t columns = std::decay<E>::type::columns;
+
+        explicit MatrixNegateExpr(E&& e) : e_(std::forward<E>(e)) {}
+
+        value_type Flat(int k) const { return value_type(0) - e_.Flat(k); }
+    private:
+        ElementwiseOperand<E> e_;
+    };
+
+    // A chain of matrix products, evaluated when assigned or applied to a vector, see MayReassociate
+    template<typename L, typename R>
+    class MatrixProduct
+    {
+    public:
+        using left_type = typename std::decay<ProductOperand<L>>::type;
+        using right_type = typename std::decay<ProductOperand<R>>::type;
+
+        using value_type = typename left_type::value_type;
+        static constexpr size_t rows = left_type::rows;
+        static constexpr size_t inner = left_type::columns;
+        static constexpr size_t columns = right_type::columns;
+
+        static_assert(std::is_same<value_type, typename right_type::value_type>::value, "matrix element types do not match");
+        static_assert(inner == right_type::rows, "matrix dimensions do not match");
+
+        MatrixProduct(L&& l, R&& r) : l_(std::forward<L>(l)), r_(std::forward<R>(r)) {}
+
+        const left_type& Left() const { return l_; }
+        const right_type& Right() const { return r_; }
+
+        Matrix<value_type, rows, columns> Eval() const;
+    private:
+        ProductOperand<L> l_;
+        ProductOperand<R> r_;
+    };
+
+    /*
+        Product reassociation
+
+        Regrouping a chain such as (A * B) * v as A * (B * v) does less work, but it rounds differently, so for float
+        and double the chains are evaluated left to right, bit for bit as the eager operators did, unless
+        MYGL_REASSOCIATE_PRODUCTS is defined as nonzero. Integer chains are always evaluated in the cheapest order.
+    */
+#if !defined(MYGL_REASSOCIATE_PRODUCTS)
+#define MYGL_REASSOCIATE_PRODUCTS 0
+#endif
+
+    template<typename T>
+    struct MayReassociate : std::integral_constant<bool, MYGL_REASSOCIATE_PRODUCTS || !std::is_floating_point<T>::value> {};
+
+    // Is (A * B) * R strictly cheaper to evaluate as A * (B * R)?
+    template<typename L, typename R> struct ReassociateLeft : std::false_type {};
+
+    template<typename A, typename B, typename R>
+    struct ReassociateLeft<MatrixProduct<A, B>, R>
+        : std::integral_constant<bool, MayReassociate<typename R::value_type>::value &&
+                                       (MatrixProduct<A, B>::inner * MatrixProduct<A, B>::columns * R::columns +
+                                        MatrixProduct<A, B>::rows * MatrixProduct<A, B>::inner * R::columns) <
+                                       (MatrixProduct<A, B>::rows * MatrixProduct<A, B>::inner * MatrixProduct<A, B>::columns +
+                                        MatrixProduct<A, B>::rows * MatrixProduct<A, B>::columns * R::columns)> {};
+
+    // Is L * (A * B) strictly cheaper to evaluate as (L * A) * B?
+    template<typename L, typename R> struct ReassociateRight : std::false_type {};
+
+    template<typename L, typename A, typename B>
+    struct ReassociateRight<L, MatrixProduct<A, B>>
+        : std::integral_constant<bool, MayReassociate<typename L::value_type>::value &&
+                                       (L::rows * L::columns * MatrixProduct<A, B>::inner +
+                                        L::rows * MatrixProduct<A, B>::inner * MatrixProduct<A, B>::columns) <
+                                       (L::columns * MatrixProduct<A, B>::inner * MatrixProduct<A, B>::columns +
+                                        L::rows * L::columns * MatrixProduct<A, B>::columns)> {};
+
+    // Is (A * B) * v strictly cheaper to evaluate as A * (B * v)?
+    template<typename E> struct ReassociateVector : std::false_type {};
+
+    template<typename A, typename B>
+    struct ReassociateVector<MatrixProduct<A, B>>
+        : std::integral_constant<bool, MayReassociate<typename MatrixProduct<A, B>::value_type>::value &&
+                                       (MatrixProduct<A, B>::inner * MatrixProduct<A, B>::columns + MatrixProduct<A, B>::rows * MatrixProduct<A, B>::inner) <
+                                       (MatrixProduct<A, B>::rows * MatrixProduct<A, B>::inner * MatrixProduct<A, B>::columns + MatrixProduct<A, B>::rows * MatrixProduct<A, B>::columns)> {};
+
+    template<typename T, size_t M, size_t N> const Matrix<T, M, N>& EvalFactor(const Matrix<T, M, N>& m) { return m; }
+    template<typename L, typename R> Matrix<typename MatrixProduct<L, R>::value_type, MatrixProduct<L, R>::rows, MatrixProduct<L, R>::columns> EvalFactor(const MatrixProduct<L, R>& p) { return p.Eval(); }
+
+    template<typename L, typename R>
+    auto EvalProduct(const L& l, const R& r, std::integral_constant<int, 0>)
+    {
+        return Multiply(EvalFactor(l), EvalFactor(r));
+    }
+
+    template<typename L, typename R>
+    auto EvalProduct(const L& l, const R& r, std::integral_constant<int, 1>) // (A * B) * R -> A * (B * R)
+    {
+        using B = typename L::right_type;
+        return Multiply(EvalFactor(l.Left()), MatrixProduct<const B&, const R&>(l.Right(), r).Eval());
+    }
+
+    template<typename L, typename R>
+    auto EvalProduct(const L& l, const R& r, std::integral_constant<int, 2>) // L * (A * B) -> (L * A) * B
+    {
+        using A = typename R::left_type;
+        return Multiply(MatrixProduct<const L&, const A&>(l, r.Left()).Eval(), EvalFactor(r.Right()));
+    }
+
+    template<typename L, typename R>
+    Matrix<typename MatrixProduct<L, R>::value_type, MatrixProduct<L, R>::rows, MatrixProduct<L, R>::columns> MatrixProduct<L, R>::Eval() const
+    {
+        using order = std::integral_constant<int, ReassociateLeft<left_type, right_type>::value ? 1 :
+                                                  ReassociateRight<left_type, right_type>::value ? 2 : 0>;
+        return EvalProduct(l_, r_, order());
+    }
+
+    template<typename T, size_t M, size_t N>
+    Vector<T, M> TransformVector(const Matrix<T, M, N>& m, const Vector<T, N>& v)
+    {
+        return Multiply(m, v);
+    }
+
+    template<typename E, size_t N>
+    Vector<typename E::value_type, E::rows> TransformVector(const MatrixExpr<E>& m, const Vector<typename E::value_type, N>& v)
+    {
+        return Multiply(MatrixResult<E>(m), v);
+    }
+
+    template<typename L, typename R, size_t N>
+    Vector<typename MatrixProduct<L, R>::value_type, MatrixProduct<L, R>::rows> TransformVector(const MatrixProduct<L, R>& p, const Vector<typename MatrixProduct<L, R>::value_type, N>& v, std::true_type)
+    {
+        return TransformVector(p.Left(), TransformVector(p.Right(), v));
+    }
+
+    template<typename L, typename R, size_t N>
+    Vector<typename MatrixProduct<L, R>::value_type, MatrixProduct<L, R>::rows> TransformVector(const MatrixProduct<L, R>& p, const Vector<typename MatrixProduct<L, R>::value_type, N>& v, std::false_type)
+    {
+        return Multiply(p.Eval(), v);
+    }
+
+    template<typename L, typename R, size_t N>
+    Vector<typename MatrixProduct<L, R>::value_type, MatrixProduct<L, R>::rows> TransformVector(const MatrixProduct<L, R>& p, const Vector<typename MatrixProduct<L, R>::value_type, N>& v)
+    {
+        return TransformVector(p, v, ReassociateVector<MatrixProduct<L, R>>());
+    }
+
+    template<typename E>
+    typename std::enable_if<IsMatrixExpr<E>::value, typename std::decay<E>::type>::type operator+(E&& m) { return std::forward<E>(m); }
+
+    template<typename E>
+    typename std::enable_if<IsMatrixLike<E>::value, MatrixNegateExpr<E>>::type operator-(E&& m) { return MatrixNegateExpr<E>(std::forward<E>(m)); }
+
+    template<typename L, typename R>
+    typename std::enable_if<IsMatrixLike<L>::value && IsMatrixLike<R>::value, MatrixBinaryExpr<L, R, AddOp>>::type operator+(L&& l, R&& r) { return MatrixBinaryExpr<L, R, AddOp>(std::forward<L>(l), std::forward<R>(r)); }
+
+    template<typename L, typename R>
+    typename std::enable_if<IsMatrixLike<L>::value && IsMatrixLike<R>::value, MatrixBinaryExpr<L, R, SubtractOp>>::type operator-(L&& l, R&& r) { return MatrixBinaryExpr<L, R, SubtractOp>(std::forward<L>(l), std::forward<R>(r)); }
+
+    template<typename L, typename R>
+    typename std::enable_if<IsMatrixLike<L>::value && IsMatrixLike<R>::value, MatrixProduct<L, R>>::type operator*(L&& l, R&& r) { return MatrixProduct<L, R>(std::forward<L>(l), std::forward<R>(r)); }
+
+    template<typename E, typename V>
+    typename std::enable_if<IsMatrixLike<E>::value && IsVectorExpr<V>::value, Vector<typename std::decay<E>::type::value_type, std::decay<E>::type::rows>>::type operator*(const E& m, const V& v)
+    {
+        return TransformVector(m, Eval(v));
     }
 
-    template<typename T, size_t M, size_t N> Matrix<T, M, N> operator+(const Matrix<T, M, N>& m) { return m; }
-    template<typename T, size_t M, size_t N> Matrix<T, M, N> operator-(const Matrix<T, M, N>& m) { return Matrix<T, M, N>() - m; }
+    template<typename E, typename U>
+    typename std::enable_if<IsMatrixLike<E>::value && std::is_arithmetic<U>::value, MatrixScalarExpr<E, MultiplyOp>>::type operator*(E&& m, U c) { return MatrixScalarExpr<E, MultiplyOp>(std::forward<E>(m), c); }
 
-    template<typename T, size_t M, size_t N> Matrix<T, M, N> operator+(const Matrix<T, M, N>& a, const Matrix<T, M, N>& b) { return a += b; }
-    template<typename T, size_t M, size_t N> Matrix<T, M, N> operator-(const Matrix<T, M, N>& a, const Matrix<T, M, N>& b) { return a -= b; }
+    template<typename E, typename U>
+    typename std::enable_if<IsMatrixLike<E>::value && std::is_arithmetic<U>::value, MatrixScalarExpr<E, MultiplyOp>>::type operator*(U c, E&& m) { return MatrixScalarExpr<E, MultiplyOp>(std::forward<E>(m), c); }
 
-    template<typename T, typename U, size_t M, size_t N> Matrix<T, M, N> operator*(Matrix<T, M, N> m, U c) { return m *= c; }
-    template<typename T, typename U, size_t M, size_t N> Matrix<T, M, N> operator*(U c, Matrix<T, M, N> m) { return m *= c; }
+    template<typename E, typename U>
+    typename std::enable_if<IsMatrixLike<E>::value && std::is_arithmetic<U>::value, MatrixScalarExpr<E, DivideOp>>::type operator/(E&& m, U c)
+    {
+        using T = typename std::decay<E>::type::value_type;
+
+        if (IsEqual<T>(c, 0))
+        {
+            throw std::logic_error("[matrix] division by zero");
+        }
 
-    template<typename T, typename U, size_t M, size_t N> Matrix<T, M, N> operator/(Matrix<T, M, N> m, U c) { return m /= c; }
+        return MatrixScalarExpr<E, DivideOp>(std::forward<E>(m), c);
+    }
 
     template<typename T, size_t M, size_t N>
     std::ostream& operator<<(std::ostream& os, const Matrix<T, M, N>& m)
@@ -536,6 +1011,18 @@ namespace mygl
         return os;
     }
 
+    template<typename E>
+    std::ostream& operator<<(std::ostream& os, const MatrixExpr<E>& m)
+    {
+        return os << MatrixResult<E>(m);
+    }
+
+    template<typename L, typename R>
+    std::ostream& operator<<(std::ostream& os, const MatrixProduct<L, R>& p)
+    {
+        return os << p.Eval();
+    }
+
     template<typename T, size_t N>
     using SquareMatrix = Matrix<T, N, N>;
 
@@ -549,12 +1036,15 @@ namespace mygl
     using mat4f = SquareMatrix<float, 4>;
     using mat4d = SquareMatrix<double, 4>;
 
-    template<typename T, size_t N> const SquareMatrix<T, N> CreateIdentity();
+    static_assert(std::is_trivially_copyable<mat4f>::value, "Matrix must be trivially copyable");
+    static_assert(sizeof(mat4f) == 16 * sizeof(float), "Matrix must be one contiguous block");
+
+    template<typename T, size_t N> constexpr const SquareMatrix<T, N> CreateIdentity();
 
-    template<typename T> const SquareMatrix<T, 2> CreateScalingMatrix2(T scaleX, T scaleY);
+    template<typename T> constexpr const SquareMatrix<T, 2> CreateScalingMatrix2(T scaleX, T scaleY);
     template<typename T> const SquareMatrix<T, 2> CreateRotationMatrix2(T angle);
 
-    template<typename T> const SquareMatrix<T, 3> CreateScalingMatrix3(T scaleX, T scaleY, T scaleZ);
+    template<typename T> constexpr const SquareMatrix<T, 3> CreateScalingMatrix3(T scaleX, T scaleY, T scaleZ);
 
     template<typename T> const SquareMatrix<T, 3> CreateRotationXMatrix3(T angle);
     template<typename T> const SquareMatrix<T, 3> CreateRotationYMatrix3(T angle);
@@ -562,11 +1052,11 @@ namespace mygl
     template<typename T> const SquareMatrix<T, 3> CreateRotationMatrix3(T yaw, T pitch, T roll);
     template<typename T> const SquareMatrix<T, 3> CreateRotationMatrix3(const Quaternion<T>& q); // q is a unit quaternion
 
-    template<typename T> const SquareMatrix<T, 4> CreateTranslationMatrix4(T dx, T dy, T dz);
-    template<typename T> const SquareMatrix<T, 4> CreateScalingMatrix4(T scaleX, T scaleY, T scaleZ);
+    template<typename T> constexpr const SquareMatrix<T, 4> CreateTranslationMatrix4(T dx, T dy, T dz);
+    template<typename T> constexpr const SquareMatrix<T, 4> CreateScalingMatrix4(T scaleX, T scaleY, T scaleZ);
 
-    template<typename T> const SquareMatrix<T, 4> CreateOrthographic4(T left, T right, T bottom, T top, T near, T far);
-    template<typename T> const SquareMatrix<T, 4> CreateViewingFrustum4(T left, T right, T bottom, T top, T near, T far);
+    template<typename T> constexpr const SquareMatrix<T, 4> CreateOrthographic4(T left, T right, T bottom, T top, T near, T far);
+    template<typename T> constexpr const SquareMatrix<T, 4> CreateViewingFrustum4(T left, T right, T bottom, T top, T near, T far);
     template<typename T> const SquareMatrix<T, 4> CreatePerspective4(T fovy, T aspect, T near, T far);
 
     template<typename T> const SquareMatrix<T, 4> CreateRotationXMatrix4(T angle);
@@ -577,10 +1067,53 @@ namespace mygl
 
     template<typename T> const SquareMatrix<T, 4> Inverse4(const SquareMatrix<T, 4>& m); // experimental
 
+    // Structure-of-arrays view of a batch of homogeneous points; the i-th point is (x[i], y[i], z[i], w[i])
+    template<typename T>
+    struct PointArrays
+    {
+        T* x;
+        T* y;
+        T* z;
+        T* w;
+    };
+
+    template<typename T> struct Identity { using type = T; }; // keeps a parameter out of template argument deduction
+
+    // Batched transforms; out may alias in. float batches are vectorized in linalg_simd.h
+    // out[i] = m * in[i]
+    template<typename T> void TransformPoints(const SquareMatrix<T, 4>& m, const Vector<T, 4>* in, Vector<T, 4>* out, size_t n);
+    template<typename T> void TransformPoints(const SquareMatrix<T, 4>& m, typename Identity<PointArrays<const T>>::type in, PointArrays<T> out, size_t n);
+    // out[i] = viewport * (v / v[3]) where v = clip * in[i], ie. projection, perspective division and viewport mapping in one pass
+    template<typename T> void ProjectPoints(const SquareMatrix<T, 4>& clip, const SquareMatrix<T, 4>& viewport, const Vector<T, 4>* in, Vector<T, 4>* out, size_t n);
+    template<typename T> void ProjectPoints(const SquareMatrix<T, 4>& clip, const SquareMatrix<T, 4>& viewport, typename Identity<PointArrays<const T>>::type in, PointArrays<T> out, size_t n);
+    // out[i] = Rotate3D(in[i], q), see above
+    template<typename T> void Rotate3D(const Quaternion<T>& q, typename Identity<PointArrays<const T>>::type in, PointArrays<T> out, size_t n);
+
     // TODO impl inverse, gaussian elimination, solve systems of eqns, determinant, find eigenvalues and eigenvectors etc... Nice reference: https://ubcmath.github.io/MATH307/index.html
 
+    // Writes the 3x3 rotation of unit quaternion q = (w, x, y, z) into the top left corner of a row-major matrix with the given row stride
+    template<typename T>
+    void QuaternionToRotation(const Quaternion<T>& q, T* R, int stride)
+    {
+        T w = q.ScalarComponent();
+        Vector<T, 3> u = q.VectorComponent();
+        T x = u.AtUnchecked(0), y = u.AtUnchecked(1), z = u.AtUnchecked(2);
+
+        R[0] = 1 - 2 * y * y - 2 * z * z;
+        R[1] = 2 * x * y - 2 * w * z;
+        R[2] = 2 * x * z + 2 * w * y;
+
+        R[stride] = 2 * x * y + 2 * w * z;
+        R[stride + 1] = 1 - 2 * x * x - 2 * z * z;
+        R[stride + 2] = 2 * y * z - 2 * w * x;
+
+        R[2 * stride] = 2 * x * z - 2 * w * y;
+        R[2 * stride + 1] = 2 * y * z + 2 * w * x;
+        R[2 * stride + 2] = 1 - 2 * x * x - 2 * y * y;
+    }
+
     template<typename T, size_t N>
-    const SquareMatrix<T, N> CreateIdentity()
+    constexpr const SquareMatrix<T, N> CreateIdentity()
     {
         SquareMatrix<T, N> id;
 
@@ -599,7 +1132,7 @@ namespace mygl
     }
 
     template<typename T>
-    const SquareMatrix<T, 2> CreateScalingMatrix2(T scaleX, T scaleY)
+    constexpr const SquareMatrix<T, 2> CreateScalingMatrix2(T scaleX, T scaleY)
     {
         SquareMatrix<T, 2> S;
 
@@ -618,7 +1151,7 @@ namespace mygl
     }
 
     template<typename T>
-    const SquareMatrix<T, 3> CreateScalingMatrix3(T scaleX, T scaleY, T scaleZ)
+    constexpr const SquareMatrix<T, 3> CreateScalingMatrix3(T scaleX, T scaleY, T scaleZ)
     {
         SquareMatrix<T, 3> S;
 
@@ -680,24 +1213,12 @@ namespace mygl
     const SquareMatrix<T, 3> CreateRotationMatrix3(const Quaternion<T>& q)
     {
         SquareMatrix<T, 3> R;
-
-        R[0][0] = 1 - 2 * q[2] * q[2] - 2 * q[3] * q[3];
-        R[0][1] = 2 * q[1] * q[2] - 2 * q[0] * q[3];
-        R[0][2] = 2 * q[1] * q[3] + 2 * q[0] * q[2];
-
-        R[1][0] = 2 * q[1] * q[2] + 2 * q[0] * q[3];
-        R[1][1] = 1 - 2 * q[1] * q[1] - 2 * q[3] * q[3];
-        R[1][2] = 2 * q[2] * q[3] - 2 * q[0] * q[1];
-
-        R[2][0] = 2 * q[1] * q[3] - 2 * q[0] * q[2];
-        R[2][1] = 2 * q[2] * q[3] + 2 * q[0] * q[1];
-        R[2][2] = 1 - 2 * q[1] * q[1] - 2 * q[2] * q[2];
-
+        QuaternionToRotation(q, R.Data(), 3);
         return R;
     }
 
     template<typename T>
-    const SquareMatrix<T, 4> CreateTranslationMatrix4(T dx, T dy, T dz)
+    constexpr const SquareMatrix<T, 4> CreateTranslationMatrix4(T dx, T dy, T dz)
     {
         SquareMatrix<T, 4> Tr = CreateIdentity<T, 4>();
 
@@ -709,7 +1230,7 @@ namespace mygl
     }
 
     template<typename T>
-    const SquareMatrix<T, 4> CreateScalingMatrix4(T scaleX, T scaleY, T scaleZ)
+    constexpr const SquareMatrix<T, 4> CreateScalingMatrix4(T scaleX, T scaleY, T scaleZ)
     {
         SquareMatrix<T, 4> S;
 
@@ -723,7 +1244,7 @@ namespace mygl
 
     // Check out: http://learnwebgl.brown37.net/08_projections/projections_ortho.html
     template<typename T>
-    const SquareMatrix<T, 4> CreateOrthographic4(T left, T right, T bottom, T top, T near, T far)
+    constexpr const SquareMatrix<T, 4> CreateOrthographic4(T left, T right, T bottom, T top, T near, T far)
     {
         if (IsEqual<T>(left, right) || IsEqual<T>(bottom, top) || IsEqual<T>(near, far))
         {
@@ -746,7 +1267,7 @@ namespace mygl
 
     // Check out: http://learnwebgl.brown37.net/08_projections/projections_perspective.html
     template<typename T>
-    const SquareMatrix<T, 4> CreateViewingFrustum4(T left, T right, T bottom, T top, T near, T far)
+    constexpr const SquareMatrix<T, 4> CreateViewingFrustum4(T left, T right, T bottom, T top, T near, T far)
     {
         if (IsEqual<T>(left, right) || IsEqual<T>(bottom, top) || IsEqual<T>(near, far))
         {
@@ -842,19 +1363,8 @@ namespace mygl
     {
         SquareMatrix<T, 4> R;
 
-        R[0][0] = 1 - 2 * q[2] * q[2] - 2 * q[3] * q[3];
-        R[0][1] = 2 * q[1] * q[2] - 2 * q[0] * q[3];
-        R[0][2] = 2 * q[1] * q[3] + 2 * q[0] * q[2];
-
-        R[1][0] = 2 * q[1] * q[2] + 2 * q[0] * q[3];
-        R[1][1] = 1 - 2 * q[1] * q[1] - 2 * q[3] * q[3];
-        R[1][2] = 2 * q[2] * q[3] - 2 * q[0] * q[1];
-
-        R[2][0] = 2 * q[1] * q[3] - 2 * q[0] * q[2];
-        R[2][1] = 2 * q[2] * q[3] + 2 * q[0] * q[1];
-        R[2][2] = 1 - 2 * q[1] * q[1] - 2 * q[2] * q[2];
-
-        R[3][3] = 1;
+        QuaternionToRotation(q, R.Data(), 4);
+        R.Flat(15) = 1;
 
         return R;
     }
@@ -865,29 +1375,29 @@ namespace mygl
     {
         SquareMatrix<T, 4> im;
 
-        T A2323 = m[2][2] * m[3][3] - m[2][3] * m[3][2];
-        T A1323 = m[2][1] * m[3][3] - m[2][3] * m[3][1];
-        T A1223 = m[2][1] * m[3][2] - m[2][2] * m[3][1];
-        T A0323 = m[2][0] * m[3][3] - m[2][3] * m[3][0];
-        T A0223 = m[2][0] * m[3][2] - m[2][2] * m[3][0];
-        T A0123 = m[2][0] * m[3][1] - m[2][1] * m[3][0];
-        T A2313 = m[1][2] * m[3][3] - m[1][3] * m[3][2];
-        T A1313 = m[1][1] * m[3][3] - m[1][3] * m[3][1];
-        T A1213 = m[1][1] * m[3][2] - m[1][2] * m[3][1];
-        T A2312 = m[1][2] * m[2][3] - m[1][3] * m[2][2];
-        T A1312 = m[1][1] * m[2][3] - m[1][3] * m[2][1];
-        T A1212 = m[1][1] * m[2][2] - m[1][2] * m[2][1];
-        T A0313 = m[1][0] * m[3][3] - m[1][3] * m[3][0];
-        T A0213 = m[1][0] * m[3][2] - m[1][2] * m[3][0];
-        T A0312 = m[1][0] * m[2][3] - m[1][3] * m[2][0];
-        T A0212 = m[1][0] * m[2][2] - m[1][2] * m[2][0];
-        T A0113 = m[1][0] * m[3][1] - m[1][1] * m[3][0];
-        T A0112 = m[1][0] * m[2][1] - m[1][1] * m[2][0];
-
-        T det = m[0][0] * ( m[1][1] * A2323 - m[1][2] * A1323 + m[1][3] * A1223 )
-              - m[0][1] * ( m[1][0] * A2323 - m[1][2] * A0323 + m[1][3] * A0223 )
-              + m[0][2] * ( m[1][0] * A1323 - m[1][1] * A0323 + m[1][3] * A0123 )
-              - m[0][3] * ( m[1][0] * A1223 - m[1][1] * A0223 + m[1][2] * A0123 );
+        T A2323 = m.AtUnchecked(2, 2) * m.AtUnchecked(3, 3) - m.AtUnchecked(2, 3) * m.AtUnchecked(3, 2);
+        T A1323 = m.AtUnchecked(2, 1) * m.AtUnchecked(3, 3) - m.AtUnchecked(2, 3) * m.AtUnchecked(3, 1);
+        T A1223 = m.AtUnchecked(2, 1) * m.AtUnchecked(3, 2) - m.AtUnchecked(2, 2) * m.AtUnchecked(3, 1);
+        T A0323 = m.AtUnchecked(2, 0) * m.AtUnchecked(3, 3) - m.AtUnchecked(2, 3) * m.AtUnchecked(3, 0);
+        T A0223 = m.AtUnchecked(2, 0) * m.AtUnchecked(3, 2) - m.AtUnchecked(2, 2) * m.AtUnchecked(3, 0);
+        T A0123 = m.AtUnchecked(2, 0) * m.AtUnchecked(3, 1) - m.AtUnchecked(2, 1) * m.AtUnchecked(3, 0);
+        T A2313 = m.AtUnchecked(1, 2) * m.AtUnchecked(3, 3) - m.AtUnchecked(1, 3) * m.AtUnchecked(3, 2);
+        T A1313 = m.AtUnchecked(1, 1) * m.AtUnchecked(3, 3) - m.AtUnchecked(1, 3) * m.AtUnchecked(3, 1);
+        T A1213 = m.AtUnchecked(1, 1) * m.AtUnchecked(3, 2) - m.AtUnchecked(1, 2) * m.AtUnchecked(3, 1);
+        T A2312 = m.AtUnchecked(1, 2) * m.AtUnchecked(2, 3) - m.AtUnchecked(1, 3) * m.AtUnchecked(2, 2);
+        T A1312 = m.AtUnchecked(1, 1) * m.AtUnchecked(2, 3) - m.AtUnchecked(1, 3) * m.AtUnchecked(2, 1);
+        T A1212 = m.AtUnchecked(1, 1) * m.AtUnchecked(2, 2) - m.AtUnchecked(1, 2) * m.AtUnchecked(2, 1);
+        T A0313 = m.AtUnchecked(1, 0) * m.AtUnchecked(3, 3) - m.AtUnchecked(1, 3) * m.AtUnchecked(3, 0);
+        T A0213 = m.AtUnchecked(1, 0) * m.AtUnchecked(3, 2) - m.AtUnchecked(1, 2) * m.AtUnchecked(3, 0);
+        T A0312 = m.AtUnchecked(1, 0) * m.AtUnchecked(2, 3) - m.AtUnchecked(1, 3) * m.AtUnchecked(2, 0);
+        T A0212 = m.AtUnchecked(1, 0) * m.AtUnchecked(2, 2) - m.AtUnchecked(1, 2) * m.AtUnchecked(2, 0);
+        T A0113 = m.AtUnchecked(1, 0) * m.AtUnchecked(3, 1) - m.AtUnchecked(1, 1) * m.AtUnchecked(3, 0);
+        T A0112 = m.AtUnchecked(1, 0) * m.AtUnchecked(2, 1) - m.AtUnchecked(1, 1) * m.AtUnchecked(2, 0);
+
+        T det = m.AtUnchecked(0, 0) * ( m.AtUnchecked(1, 1) * A2323 - m.AtUnchecked(1, 2) * A1323 + m.AtUnchecked(1, 3) * A1223 )
+              - m.AtUnchecked(0, 1) * ( m.AtUnchecked(1, 0) * A2323 - m.AtUnchecked(1, 2) * A0323 + m.AtUnchecked(1, 3) * A0223 )
+              + m.AtUnchecked(0, 2) * ( m.AtUnchecked(1, 0) * A1323 - m.AtUnchecked(1, 1) * A0323 + m.AtUnchecked(1, 3) * A0123 )
+              - m.AtUnchecked(0, 3) * ( m.AtUnchecked(1, 0) * A1223 - m.AtUnchecked(1, 1) * A0223 + m.AtUnchecked(1, 2) * A0123 );
 
         if (IsEqual<T>(det, 0))
         {
@@ -896,26 +1406,319 @@ namespace mygl
 
         det = 1 / det;
 
-        im[0][0] = det *   ( m[1][1] * A2323 - m[1][2] * A1323 + m[1][3] * A1223 );
-        im[0][1] = det * - ( m[0][1] * A2323 - m[0][2] * A1323 + m[0][3] * A1223 );
-        im[0][2] = det *   ( m[0][1] * A2313 - m[0][2] * A1313 + m[0][3] * A1213 );
-        im[0][3] = det * - ( m[0][1] * A2312 - m[0][2] * A1312 + m[0][3] * A1212 );
-        im[1][0] = det * - ( m[1][0] * A2323 - m[1][2] * A0323 + m[1][3] * A0223 );
-        im[1][1] = det *   ( m[0][0] * A2323 - m[0][2] * A0323 + m[0][3] * A0223 );
-        im[1][2] = det * - ( m[0][0] * A2313 - m[0][2] * A0313 + m[0][3] * A0213 );
-        im[1][3] = det *   ( m[0][0] * A2312 - m[0][2] * A0312 + m[0][3] * A0212 );
-        im[2][0] = det *   ( m[1][0] * A1323 - m[1][1] * A0323 + m[1][3] * A0123 );
-        im[2][1] = det * - ( m[0][0] * A1323 - m[0][1] * A0323 + m[0][3] * A0123 );
-        im[2][2] = det *   ( m[0][0] * A1313 - m[0][1] * A0313 + m[0][3] * A0113 );
-        im[2][3] = det * - ( m[0][0] * A1312 - m[0][1] * A0312 + m[0][3] * A0112 );
-        im[3][0] = det * - ( m[1][0] * A1223 - m[1][1] * A0223 + m[1][2] * A0123 );
-        im[3][1] = det *   ( m[0][0] * A1223 - m[0][1] * A0223 + m[0][2] * A0123 );
-        im[3][2] = det * - ( m[0][0] * A1213 - m[0][1] * A0213 + m[0][2] * A0113 );
-        im[3][3] = det *   ( m[0][0] * A1212 - m[0][1] * A0212 + m[0][2] * A0112 );
+        im.AtUnchecked(0, 0) = det *   ( m.AtUnchecked(1, 1) * A2323 - m.AtUnchecked(1, 2) * A1323 + m.AtUnchecked(1, 3) * A1223 );
+        im.AtUnchecked(0, 1) = det * - ( m.AtUnchecked(0, 1) * A2323 - m.AtUnchecked(0, 2) * A1323 + m.AtUnchecked(0, 3) * A1223 );
+        im.AtUnchecked(0, 2) = det *   ( m.AtUnchecked(0, 1) * A2313 - m.AtUnchecked(0, 2) * A1313 + m.AtUnchecked(0, 3) * A1213 );
+        im.AtUnchecked(0, 3) = det * - ( m.AtUnchecked(0, 1) * A2312 - m.AtUnchecked(0, 2) * A1312 + m.AtUnchecked(0, 3) * A1212 );
+        im.AtUnchecked(1, 0) = det * - ( m.AtUnchecked(1, 0) * A2323 - m.AtUnchecked(1, 2) * A0323 + m.AtUnchecked(1, 3) * A0223 );
+        im.AtUnchecked(1, 1) = det *   ( m.AtUnchecked(0, 0) * A2323 - m.AtUnchecked(0, 2) * A0323 + m.AtUnchecked(0, 3) * A0223 );
+        im.AtUnchecked(1, 2) = det * - ( m.AtUnchecked(0, 0) * A2313 - m.AtUnchecked(0, 2) * A0313 + m.AtUnchecked(0, 3) * A0213 );
+        im.AtUnchecked(1, 3) = det *   ( m.AtUnchecked(0, 0) * A2312 - m.AtUnchecked(0, 2) * A0312 + m.AtUnchecked(0, 3) * A0212 );
+        im.AtUnchecked(2, 0) = det *   ( m.AtUnchecked(1, 0) * A1323 - m.AtUnchecked(1, 1) * A0323 + m.AtUnchecked(1, 3) * A0123 );
+        im.AtUnchecked(2, 1) = det * - ( m.AtUnchecked(0, 0) * A1323 - m.AtUnchecked(0, 1) * A0323 + m.AtUnchecked(0, 3) * A0123 );
+        im.AtUnchecked(2, 2) = det *   ( m.AtUnchecked(0, 0) * A1313 - m.AtUnchecked(0, 1) * A0313 + m.AtUnchecked(0, 3) * A0113 );
+        im.AtUnchecked(2, 3) = det * - ( m.AtUnchecked(0, 0) * A1312 - m.AtUnchecked(0, 1) * A0312 + m.AtUnchecked(0, 3) * A0112 );
+        im.AtUnchecked(3, 0) = det * - ( m.AtUnchecked(1, 0) * A1223 - m.AtUnchecked(1, 1) * A0223 + m.AtUnchecked(1, 2) * A0123 );
+        im.AtUnchecked(3, 1) = det *   ( m.AtUnchecked(0, 0) * A1223 - m.AtUnchecked(0, 1) * A0223 + m.AtUnchecked(0, 2) * A0123 );
+        im.AtUnchecked(3, 2) = det * - ( m.AtUnchecked(0, 0) * A1213 - m.AtUnchecked(0, 1) * A0213 + m.AtUnchecked(0, 2) * A0113 );
+        im.AtUnchecked(3, 3) = det *   ( m.AtUnchecked(0, 0) * A1212 - m.AtUnchecked(0, 1) * A0212 + m.AtUnchecked(0, 2) * A0112 );
 
         return im;
     }
 
+    template<typename T>
+    void TransformPoints(const SquareMatrix<T, 4>& m, const Vector<T, 4>* in, Vector<T, 4>* out, size_t n)
+    {
+        MYGL_PROFILE_ZONE("TransformPoints");
+
+        for (size_t i = 0; i < n; ++i)
+        {
+            out[i] = m * in[i];
+        }
+    }
+
+    template<typename T>
+    void TransformPoints(const SquareMatrix<T, 4>& m, typename Identity<PointArrays<const T>>::type in, PointArrays<T> out, size_t n)
+    {
+        MYGL_PROFILE_ZONE("TransformPoints");
+
+        for (size_t i = 0; i < n; ++i)
+        {
+            Vector<T, 4> v = m * Vector<T, 4>(in.x[i], in.y[i], in.z[i], in.w[i]);
+
+            out.x[i] = v[0];
+            out.y[i] = v[1];
+            out.z[i] = v[2];
+            out.w[i] = v[3];
+        }
+    }
+
+    template<typename T>
+    void ProjectPoints(const SquareMatrix<T, 4>& clip, const SquareMatrix<T, 4>& viewport, const Vector<T, 4>* in, Vector<T, 4>* out, size_t n)
+    {
+        MYGL_PROFILE_ZONE("ProjectPoints");
+
+        for (size_t i = 0; i < n; ++i)
+        {
+            Vector<T, 4> v = clip * in[i];
+            v /= v[3];
+            out[i] = viewport * v;
+        }
+    }
+
+    template<typename T>
+    void ProjectPoints(const SquareMatrix<T, 4>& clip, const SquareMatrix<T, 4>& viewport, typename Identity<PointArrays<const T>>::type in, PointArrays<T> out, size_t n)
+    {
+        MYGL_PROFILE_ZONE("ProjectPoints");
+
+        for (size_t i = 0; i < n; ++i)
+        {
+            Vector<T, 4> v = clip * Vector<T, 4>(in.x[i], in.y[i], in.z[i], in.w[i]);
+            v /= v[3];
+            v = viewport * v;
+
+            out.x[i] = v[0];
+            out.y[i] = v[1];
+            out.z[i] = v[2];
+            out.w[i] = v[3];
+        }
+    }
+
+    /*
+        Affine transform x -> Ax + t of 3D space, stored as the top three rows [A | t] of the 4x4 matrix it stands for
+        (the bottom row of which is always 0 0 0 1). Composing two takes 36 multiplications instead of 64, and rigid
+        transforms (A is a rotation) are inverted by transposing A and fixing up t.
+    */
+    template<typename T>
+    class Affine3
+    {
+    public:
+        using value_type = T;
+
+        constexpr Affine3() : m_{{1, 0, 0, 0}, {0, 1, 0, 0}, {0, 0, 1, 0}} {} // identity
+        constexpr explicit Affine3(const SquareMatrix<T, 3>& linear, const Vector<T, 3>& translation = Vector<T, 3>());
+        constexpr explicit Affine3(const SquareMatrix<T, 4>& m); // the bottom row of m is assumed to be 0 0 0 1
+
+        constexpr SquareMatrix<T, 4> ToMatrix4() const;
+
+        constexpr SquareMatrix<T, 3> Linear() const;
+        constexpr Vector<T, 3> Translation() const;
+
+        // Element (row, column) of [A | t]
+        constexpr T AtUnchecked(int row, int column) const { return m_.AtUnchecked(row, column); }
+        constexpr T& AtUnchecked(int row, int column) { return m_.AtUnchecked(row, column); }
+
+        // Raw access to the 12 contiguous row-major elements of [A | t]
+        constexpr const T* Data() const { return m_.Data(); }
+        constexpr T* Data() { return m_.Data(); }
+
+        Affine3 Inverse() const;
+        constexpr Affine3 InverseRigid() const; // only valid if A is a rotation
+    private:
+        Matrix<T, 3, 4> m_;
+    };
+
+    template<typename T>
+    constexpr Affine3<T>::Affine3(const SquareMatrix<T, 3>& linear, const Vector<T, 3>& translation)
+    {
+        for (int i = 0; i < 3; ++i)
+        {
+            for (int j = 0; j < 3; ++j)
+            {
+                m_.AtUnchecked(i, j) = linear.AtUnchecked(i, j);
+            }
+
+            m_.AtUnchecked(i, 3) = translation.AtUnchecked(i);
+        }
+    }
+
+    template<typename T>
+    constexpr Affine3<T>::Affine3(const SquareMatrix<T, 4>& m)
+    {
+        // the top three rows of a row-major 4x4 matrix are its first 12 elements
+        for (int k = 0; k < 12; ++k)
+        {
+            m_.Flat(k) = m.Flat(k);
+        }
+    }
+
+    template<typename T>
+    constexpr SquareMatrix<T, 4> Affine3<T>::ToMatrix4() const
+    {
+        SquareMatrix<T, 4> r;
+
+        for (int k = 0; k < 12; ++k)
+        {
+            r.Flat(k) = m_.Flat(k);
+        }
+
+        r.Flat(15) = 1;
+
+        return r;
+    }
+
+    template<typename T>
+    constexpr SquareMatrix<T, 3> Affine3<T>::Linear() const
+    {
+        SquareMatrix<T, 3> A;
+
+        for (int i = 0; i < 3; ++i)
+        {
+            for (int j = 0; j < 3; ++j)
+            {
+                A.AtUnchecked(i, j) = m_.AtUnchecked(i, j);
+            }
+        }
+
+        return A;
+    }
+
+    template<typename T>
+    constexpr Vector<T, 3> Affine3<T>::Translation() const
+    {
+        return Vector<T, 3>(m_.AtUnchecked(0, 3), m_.AtUnchecked(1, 3), m_.AtUnchecked(2, 3));
+    }
+
+    // A^-1 is the adjugate over the determinant, and the inverse translation is -A^-1 t
+    template<typename T>
+    Affine3<T> Affine3<T>::Inverse() const
+    {
+        const Matrix<T, 3, 4>& m = m_;
+
+        T C00 = m.AtUnchecked(1, 1) * m.AtUnchecked(2, 2) - m.AtUnchecked(1, 2) * m.AtUnchecked(2, 1);
+        T C01 = m.AtUnchecked(1, 2) * m.AtUnchecked(2, 0) - m.AtUnchecked(1, 0) * m.AtUnchecked(2, 2);
+        T C02 = m.AtUnchecked(1, 0) * m.AtUnchecked(2, 1) - m.AtUnchecked(1, 1) * m.AtUnchecked(2, 0);
+
+        T det = m.AtUnchecked(0, 0) * C00 + m.AtUnchecked(0, 1) * C01 + m.AtUnchecked(0, 2) * C02;
+
+        if (IsEqual<T>(det, 0))
+        {
+            throw std::logic_error("Uninvertible matrix!");
+        }
+
+        det = 1 / det;
+
+        Affine3 inv;
+
+        inv.AtUnchecked(0, 0) = det * C00;
+        inv.AtUnchecked(0, 1) = det * (m.AtUnchecked(0, 2) * m.AtUnchecked(2, 1) - m.AtUnchecked(0, 1) * m.AtUnchecked(2, 2));
+        inv.AtUnchecked(0, 2) = det * (m.AtUnchecked(0, 1) * m.AtUnchecked(1, 2) - m.AtUnchecked(0, 2) * m.AtUnchecked(1, 1));
+        inv.AtUnchecked(1, 0) = det * C01;
+        inv.AtUnchecked(1, 1) = det * (m.AtUnchecked(0, 0) * m.AtUnchecked(2, 2) - m.AtUnchecked(0, 2) * m.AtUnchecked(2, 0));
+        inv.AtUnchecked(1, 2) = det * (m.AtUnchecked(0, 2) * m.AtUnchecked(1, 0) - m.AtUnchecked(0, 0) * m.AtUnchecked(1, 2));
+        inv.AtUnchecked(2, 0) = det * C02;
+        inv.AtUnchecked(2, 1) = det * (m.AtUnchecked(0, 1) * m.AtUnchecked(2, 0) - m.AtUnchecked(0, 0) * m.AtUnchecked(2, 1));
+        inv.AtUnchecked(2, 2) = det * (m.AtUnchecked(0, 0) * m.AtUnchecked(1, 1) - m.AtUnchecked(0, 1) * m.AtUnchecked(1, 0));
+
+        for (int i = 0; i < 3; ++i)
+        {
+            inv.AtUnchecked(i, 3) = -(inv.AtUnchecked(i, 0) * m.AtUnchecked(0, 3) + inv.AtUnchecked(i, 1) * m.AtUnchecked(1, 3) + inv.AtUnchecked(i, 2) * m.AtUnchecked(2, 3));
+        }
+
+        return inv;
+    }
+
+    // The inverse of a rotation is its transpose, and the inverse translation is -A^T t
+    template<typename T>
+    constexpr Affine3<T> Affine3<T>::InverseRigid() const
+    {
+        Affine3 inv;
+
+        for (int i = 0; i < 3; ++i)
+        {
+            for (int j = 0; j < 3; ++j)
+            {
+                inv.AtUnchecked(i, j) = m_.AtUnchecked(j, i);
+            }
+
+            inv.AtUnchecked(i, 3) = -(m_.AtUnchecked(0, i) * m_.AtUnchecked(0, 3) + m_.AtUnchecked(1, i) * m_.AtUnchecked(1, 3) + m_.AtUnchecked(2, i) * m_.AtUnchecked(2, 3));
+        }
+
+        return inv;
+    }
+
+    // Composition (apply b first, then a); each element is summed in the same order as the equivalent 4x4 product
+    template<typename T>
+    constexpr Affine3<T> operator*(const Affine3<T>& a, const Affine3<T>& b)
+    {
+        Affine3<T> c;
+
+        for (int i = 0; i < 3; ++i)
+        {
+            for (int j = 0; j < 4; ++j)
+            {
+                T total = 0;
+
+                for (int k = 0; k < 3; ++k)
+                {
+                    total += a.AtUnchecked(i, k) * b.AtUnchecked(k, j);
+                }
+
+                if (j == 3)
+                {
+                    total += a.AtUnchecked(i, 3);
+                }
+
+                c.AtUnchecked(i, j) = total;
+            }
+        }
+
+        return c;
+    }
+
+    // Homogeneous point or direction; w passes through unchanged
+    template<typename T>
+    constexpr Vector<T, 4> operator*(const Affine3<T>& a, const Vector<T, 4>& v)
+    {
+        Vector<T, 4> r;
+
+        for (int i = 0; i < 3; ++i)
+        {
+            T total = 0;
+
+            for (int k = 0; k < 4; ++k)
+            {
+                total += a.AtUnchecked(i, k) * v.AtUnchecked(k);
+            }
+
+            r.AtUnchecked(i) = total;
+        }
+
+        r.AtUnchecked(3) = v.AtUnchecked(3);
+
+        return r;
+    }
+
+    // Point (ie. w = 1)
+    template<typename T>
+    constexpr Vector<T, 3> operator*(const Affine3<T>& a, const Vector<T, 3>& p)
+    {
+        Vector<T, 3> r;
+
+        for (int i = 0; i < 3; ++i)
+        {
+            T total = 0;
+
+            for (int k = 0; k < 3; ++k)
+            {
+                total += a.AtUnchecked(i, k) * p.AtUnchecked(k);
+            }
+
+            r.AtUnchecked(i) = total + a.AtUnchecked(i, 3);
+        }
+
+        return r;
+    }
+
+    template<typename T>
+    std::ostream& operator<<(std::ostream& os, const Affine3<T>& a)
+    {
+        return os << a.ToMatrix4();
+    }
+
+    using affine3f = Affine3<float>;
+    using affine3d = Affine3<double>;
+
     template<typename T>
     class Quaternion
     {
@@ -923,10 +1726,9 @@ namespace mygl
         Quaternion(bool unit = false) : s_(unit) {}
         Quaternion(T s, const Vector<T, 3>& v) : s_(s), v_(v) {}
         Quaternion(const Vector<T, 3>& axis, T angle); // Create a unit quaternion from rotation axis and angle
-        Quaternion(const Quaternion& q) { *this = q; }
-        ~Quaternion() {}
+        Quaternion(const Quaternion& q) = default;
 
-        Quaternion& operator=(const Quaternion& q);
+        Quaternion& operator=(const Quaternion& q) = default;
         Quaternion& operator+=(const Quaternion& q);
         Quaternion& operator-=(const Quaternion& q);
         Quaternion& operator*=(T r);
@@ -958,14 +1760,6 @@ namespace mygl
         v_ = axis.Unit() * std::sin(angle / 2);
     }
 
-    template<typename T>
-    Quaternion<T>& Quaternion<T>::operator=(const Quaternion<T>& q)
-    {
-        s_ = q.s_;
-        v_ = q.v_;
-        return *this;
-    }
-
     template<typename T>
     Quaternion<T>& Quaternion<T>::operator+=(const Quaternion<T>& q)
     {
@@ -1095,6 +1889,64 @@ namespace mygl
         os << '[' << q.ScalarComponent() << ", " << q.VectorComponent() << ']';
         return os;
     }
+
+    // Over a batch the rotation matrix is built once, after which every point costs 9 multiplications instead of 21
+    template<typename T>
+    void Rotate3D(const Quaternion<T>& q, const Vector<T, 3>* in, Vector<T, 3>* out, size_t n)
+    {
+        MYGL_PROFILE_ZONE("Rotate3D");
+
+        const SquareMatrix<T, 3> R = CreateRotationMatrix3<T>(q);
+
+        const T r00 = R.Flat(0), r01 = R.Flat(1), r02 = R.Flat(2);
+        const T r10 = R.Flat(3), r11 = R.Flat(4), r12 = R.Flat(5);
+        const T r20 = R.Flat(6), r21 = R.Flat(7), r22 = R.Flat(8);
+
+        for (size_t i = 0; i < n; ++i)
+        {
+            T x = in[i].AtUnchecked(0), y = in[i].AtUnchecked(1), z = in[i].AtUnchecked(2);
+
+            out[i] = Vector<T, 3>(r00 * x + r01 * y + r02 * z,
+                                  r10 * x + r11 * y + r12 * z,
+                                  r20 * x + r21 * y + r22 * z);
+        }
+    }
+
+    template<typename T>
+    void Rotate3D(const Quaternion<T>& q, const Vector<T, 4>* in, Vector<T, 4>* out, size_t n)
+    {
+        MYGL_PROFILE_ZONE("Rotate3D");
+
+        const Affine3<T> R(CreateRotationMatrix3<T>(q));
+
+        for (size_t i = 0; i < n; ++i)
+        {
+            out[i] = R * in[i];
+        }
+    }
+
+    template<typename T>
+    void Rotate3D(const Quaternion<T>& q, typename Identity<PointArrays<const T>>::type in, PointArrays<T> out, size_t n)
+    {
+        MYGL_PROFILE_ZONE("Rotate3D");
+
+        const SquareMatrix<T, 3> R = CreateRotationMatrix3<T>(q);
+
+        const T r00 = R.Flat(0), r01 = R.Flat(1), r02 = R.Flat(2);
+        const T r10 = R.Flat(3), r11 = R.Flat(4), r12 = R.Flat(5);
+        const T r20 = R.Flat(6), r21 = R.Flat(7), r22 = R.Flat(8);
+
+        for (size_t i = 0; i < n; ++i)
+        {
+            T x = in.x[i], y = in.y[i], z = in.z[i];
+
+            out.x[i] = r00 * x + r01 * y + r02 * z;
+            out.y[i] = r10 * x + r11 * y + r12 * z;
+            out.z[i] = r20 * x + r21 * y + r22 * z;
+        }
+    }
 }
 
+#include "linalg_simd.h"
+
 #endif /* _LINALG_H_ */
\ No newline at end of file
@@ -0,0 +1,616 @@
+#ifndef _LINALG_SIMD_H_
+#define _LINALG_SIMD_H_
+
+/*
+    SSE/AVX kernels for vec4f, mat4f, vec4d and mat4d
+
+    This file is included at the end of linalg.h. The kernels are chosen at compile time from the target flags
+    (-msse2 is the default on x86-64, add -mavx or -mavx2 or -march=native for the double kernels); anything that
+    is not covered here falls back to the generic templates in linalg.h. Define MYGL_NO_SIMD to force the scalar
+    path everywhere, e.g. to compare the two with benchmark.cpp.
+
+    Dot products, mat*vec and mat*mat add the partial products in the same order as the scalar loops. Inverse4
+    uses the 2x2 block formulation instead of cofactor expansion, so its results may differ in the last bits.
+*/
+
+#if !defined(MYGL_NO_SIMD)
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define MYGL_SSE2
+#endif
+#if defined(__AVX__)
+#define MYGL_AVX
+#endif
+#if defined(__AVX2__)
+#define MYGL_AVX2
+#endif
+#endif
+
+#if defined(MYGL_AVX)
+#include <immintrin.h>
+#elif defined(MYGL_SSE2)
+#include <emmintrin.h>
+#endif
+
+namespace mygl
+{
+namespace simd
+{
+#if defined(MYGL_SSE2)
+    inline __m128 Load(const float* p) { return _mm_loadu_ps(p); }
+    inline void Store(float* p, __m128 v) { _mm_storeu_ps(p, v); }
+    inline __m128 Set1(float s) { return _mm_set1_ps(s); }
+    inline __m128 Add(__m128 a, __m128 b) { return _mm_add_ps(a, b); }
+    inline __m128 Sub(__m128 a, __m128 b) { return _mm_sub_ps(a, b); }
+    inline __m128 Mul(__m128 a, __m128 b) { return _mm_mul_ps(a, b); }
+    inline __m128 Div(__m128 a, __m128 b) { return _mm_div_ps(a, b); }
+    inline float Lane0(__m128 v) { return _mm_cvtss_f32(v); }
+
+    // (v[x], v[y], v[z], v[w])
+    template<int x, int y, int z, int w> inline __m128 Swizzle(__m128 v) { return _mm_shuffle_ps(v, v, x | (y << 2) | (z << 4) | (w << 6)); }
+
+    // (a[x], a[y], b[z], b[w])
+    template<int x, int y, int z, int w> inline __m128 Shuffle(__m128 a, __m128 b) { return _mm_shuffle_ps(a, b, x | (y << 2) | (z << 4) | (w << 6)); }
+
+    inline __m128 Shuffle0101(__m128 a, __m128 b) { return _mm_movelh_ps(a, b); }
+    inline __m128 Shuffle2323(__m128 a, __m128 b) { return _mm_movehl_ps(b, a); }
+
+    inline void Transpose(__m128& r0, __m128& r1, __m128& r2, __m128& r3) { _MM_TRANSPOSE4_PS(r0, r1, r2, r3); }
+#endif
+
+#if defined(MYGL_AVX)
+    inline __m256d Load(const double* p) { return _mm256_loadu_pd(p); }
+    inline void Store(double* p, __m256d v) { _mm256_storeu_pd(p, v); }
+    inline __m256d Set1(double s) { return _mm256_set1_pd(s); }
+    inline __m256d Add(__m256d a, __m256d b) { return _mm256_add_pd(a, b); }
+    inline __m256d Sub(__m256d a, __m256d b) { return _mm256_sub_pd(a, b); }
+    inline __m256d Mul(__m256d a, __m256d b) { return _mm256_mul_pd(a, b); }
+    inline __m256d Div(__m256d a, __m256d b) { return _mm256_div_pd(a, b); }
+    inline double Lane0(__m256d v) { return _mm256_cvtsd_f64(v); }
+
+    inline __m256 Add(__m256 a, __m256 b) { return _mm256_add_ps(a, b); }
+    inline __m256 Sub(__m256 a, __m256 b) { return _mm256_sub_ps(a, b); }
+    inline __m256 Mul(__m256 a, __m256 b) { return _mm256_mul_ps(a, b); }
+    inline __m256 Div(__m256 a, __m256 b) { return _mm256_div_ps(a, b); }
+
+    inline __m256d Shuffle0101(__m256d a, __m256d b) { return _mm256_permute2f128_pd(a, b, 0x20); }
+    inline __m256d Shuffle2323(__m256d a, __m256d b) { return _mm256_permute2f128_pd(a, b, 0x31); }
+
+    inline void Transpose(__m256d& r0, __m256d& r1, __m256d& r2, __m256d& r3)
+    {
+        __m256d t0 = _mm256_unpacklo_pd(r0, r1); // r0[0] r1[0] r0[2] r1[2]
+        __m256d t1 = _mm256_unpackhi_pd(r0, r1); // r0[1] r1[1] r0[3] r1[3]
+        __m256d t2 = _mm256_unpacklo_pd(r2, r3);
+        __m256d t3 = _mm256_unpackhi_pd(r2, r3);
+
+        r0 = _mm256_permute2f128_pd(t0, t2, 0x20);
+        r1 = _mm256_permute2f128_pd(t1, t3, 0x20);
+        r2 = _mm256_permute2f128_pd(t0, t2, 0x31);
+        r3 = _mm256_permute2f128_pd(t1, t3, 0x31);
+    }
+#endif
+
+#if defined(MYGL_AVX2)
+    template<int x, int y, int z, int w> inline __m256d Swizzle(__m256d v) { return _mm256_permute4x64_pd(v, x | (y << 2) | (z << 4) | (w << 6)); }
+
+    template<int x, int y, int z, int w> inline __m256d Shuffle(__m256d a, __m256d b)
+    {
+        return _mm256_blend_pd(Swizzle<x, y, x, y>(a), Swizzle<z, w, z, w>(b), 0b1100);
+    }
+#endif
+
+#if defined(MYGL_SSE2) || defined(MYGL_AVX)
+    // ((v[0] + v[1]) + v[2]) + v[3], the same order as the scalar loops
+    template<typename V>
+    inline V SumInOrder(V p0, V p1, V p2, V p3)
+    {
+        return Add(Add(Add(p0, p1), p2), p3);
+    }
+
+    // c = a * b for row-major 4x4 matrices, accumulating c[i] = a[i][0] * b[0] + ... + a[i][3] * b[3] row by row
+    template<typename T>
+    inline void MultiplyMatrix4(const T* a, const T* b, T* c)
+    {
+        auto b0 = Load(b);
+        auto b1 = Load(b + 4);
+        auto b2 = Load(b + 8);
+        auto b3 = Load(b + 12);
+
+        for (int i = 0; i < 4; ++i)
+        {
+            const T* ai = a + 4 * i;
+
+            Store(c + 4 * i, SumInOrder(Mul(Set1(ai[0]), b0), Mul(Set1(ai[1]), b1), Mul(Set1(ai[2]), b2), Mul(Set1(ai[3]), b3)));
+        }
+    }
+
+    // c = m * v; the four row products are transposed so that each output lane sums its row in order
+    template<typename T>
+    inline void MultiplyVector4(const T* m, const T* v, T* c)
+    {
+        auto x = Load(v);
+
+        auto p0 = Mul(Load(m), x);
+        auto p1 = Mul(Load(m + 4), x);
+        auto p2 = Mul(Load(m + 8), x);
+        auto p3 = Mul(Load(m + 12), x);
+
+        Transpose(p0, p1, p2, p3);
+
+        Store(c, SumInOrder(p0, p1, p2, p3));
+    }
+
+    // Same as above for affine [A | t] blocks, which are the top 3 rows of a 4x4 matrix whose bottom row is (0, 0, 0, 1)
+    template<typename T>
+    inline void MultiplyAffine3(const T* a, const T* b, T* c)
+    {
+        static const T unit[4] = {0, 0, 0, 1};
+
+        auto b0 = Load(b);
+        auto b1 = Load(b + 4);
+        auto b2 = Load(b + 8);
+        auto b3 = Load(unit);
+
+        for (int i = 0; i < 3; ++i)
+        {
+            const T* ai = a + 4 * i;
+
+            Store(c + 4 * i, SumInOrder(Mul(Set1(ai[0]), b0), Mul(Set1(ai[1]), b1), Mul(Set1(ai[2]), b2), Mul(Set1(ai[3]), b3)));
+        }
+    }
+
+    template<typename T>
+    inline void MultiplyAffineVector3(const T* a, const T* v, T* c)
+    {
+        static const T unit[4] = {0, 0, 0, 1};
+
+        auto x = Load(v);
+
+        auto p0 = Mul(Load(a), x);
+        auto p1 = Mul(Load(a + 4), x);
+        auto p2 = Mul(Load(a + 8), x);
+        auto p3 = Mul(Load(unit), x);
+
+        Transpose(p0, p1, p2, p3);
+
+        Store(c, SumInOrder(p0, p1, p2, p3));
+    }
+
+    template<typename T>
+    inline void Transpose4(const T* m, T* t)
+    {
+        auto r0 = Load(m);
+        auto r1 = Load(m + 4);
+        auto r2 = Load(m + 8);
+        auto r3 = Load(m + 12);
+
+        Transpose(r0, r1, r2, r3);
+
+        Store(t, r0);
+        Store(t + 4, r1);
+        Store(t + 8, r2);
+        Store(t + 12, r3);
+    }
+
+    template<typename T>
+    inline T Dot4(const T* a, const T* b)
+    {
+        alignas(32) T p[4];
+
+        Store(p, Mul(Load(a), Load(b)));
+
+        return ((p[0] + p[1]) + p[2]) + p[3];
+    }
+
+    // 2x2 row-major blocks packed as (m00, m01, m10, m11)
+
+    // A * B
+    template<typename V> inline V Mat2Mul(V a, V b)
+    {
+        return Add(Mul(a, Swizzle<0, 3, 0, 3>(b)), Mul(Swizzle<1, 0, 3, 2>(a), Swizzle<2, 1, 2, 1>(b)));
+    }
+
+    // adj(A) * B
+    template<typename V> inline V Mat2AdjMul(V a, V b)
+    {
+        return Sub(Mul(Swizzle<3, 3, 0, 0>(a), b), Mul(Swizzle<1, 1, 2, 2>(a), Swizzle<2, 3, 0, 1>(b)));
+    }
+
+    // A * adj(B)
+    template<typename V> inline V Mat2MulAdj(V a, V b)
+    {
+        return Sub(Mul(a, Swizzle<3, 0, 3, 0>(b)), Mul(Swizzle<1, 0, 3, 2>(a), Swizzle<2, 1, 2, 1>(b)));
+    }
+
+    // Inverse of a row-major 4x4 matrix by blockwise inversion of its four 2x2 sub-matrices
+    // See: https://lxjk.github.io/2017/09/03/Fast-4x4-Matrix-Inverse-with-SSE-SIMD-Explained.html
+    template<typename T>
+    inline void Inverse4(const T* m, T* im)
+    {
+        auto r0 = Load(m);
+        auto r1 = Load(m + 4);
+        auto r2 = Load(m + 8);
+        auto r3 = Load(m + 12);
+
+        auto A = Shuffle0101(r0, r1);
+        auto B = Shuffle2323(r0, r1);
+        auto C = Shuffle0101(r2, r3);
+        auto D = Shuffle2323(r2, r3);
+
+        // (|A|, |B|, |C|, |D|)
+        auto detSub = Sub(Mul(Shuffle<0, 2, 0, 2>(r0, r2), Shuffle<1, 3, 1, 3>(r1, r3)),
+                          Mul(Shuffle<1, 3, 1, 3>(r0, r2), Shuffle<0, 2, 0, 2>(r1, r3)));
+
+        auto detA = Swizzle<0, 0, 0, 0>(detSub);
+        auto detB = Swizzle<1, 1, 1, 1>(detSub);
+        auto detC = Swizzle<2, 2, 2, 2>(detSub);
+        auto detD = Swizzle<3, 3, 3, 3>(detSub);
+
+        auto D_C = Mat2AdjMul(D, C);
+        auto A_B = Mat2AdjMul(A, B);
+
+        auto X_ = Sub(Mul(detD, A), Mat2Mul(B, D_C));
+        auto W_ = Sub(Mul(detA, D), Mat2Mul(C, A_B));
+        auto Y_ = Sub(Mul(detB, C), Mat2MulAdj(D, A_B));
+        auto Z_ = Sub(Mul(detC, B), Mat2MulAdj(A, D_C));
+
+        // |M| = |A| |D| + |B| |C| - tr(adj(A) B adj(D) C)
+        auto tr = Mul(A_B, Swizzle<0, 2, 1, 3>(D_C));
+        tr = Add(tr, Swizzle<1, 0, 3, 2>(tr));
+        tr = Add(tr, Swizzle<2, 3, 0, 1>(tr));
+
+        auto detM = Sub(Add(Mul(detA, detD), Mul(detB, detC)), tr);
+
+        if (IsEqual<T>(Lane0(detM), 0))
+        {
+            throw std::logic_error("Uninvertible matrix!");
+        }
+
+        alignas(32) const T sign[4] = {1, -1, -1, 1};
+        auto rDetM = Div(Load(sign), detM);
+
+        X_ = Mul(X_, rDetM);
+        Y_ = Mul(Y_, rDetM);
+        Z_ = Mul(Z_, rDetM);
+        W_ = Mul(W_, rDetM);
+
+        // undo the adjugate and interleave the blocks back into rows
+        Store(im, Shuffle<3, 1, 3, 1>(X_, Y_));
+        Store(im + 4, Shuffle<2, 0, 2, 0>(X_, Y_));
+        Store(im + 8, Shuffle<3, 1, 3, 1>(Z_, W_));
+        Store(im + 12, Shuffle<2, 0, 2, 0>(Z_, W_));
+    }
+#endif
+
+#if defined(MYGL_SSE2)
+    // Loading, storing and transposing batches of float points, one point per lane
+    template<size_t W> struct FloatLanes;
+
+    template<>
+    struct FloatLanes<4>
+    {
+        static const size_t width = 4;
+
+        static __m128 Load(const float* p) { return _mm_loadu_ps(p); }
+        static void Store(float* p, __m128 v) { _mm_storeu_ps(p, v); }
+        static __m128 Splat(float s) { return _mm_set1_ps(s); }
+
+        // lanes where |v| < s
+        static __m128 AbsLess(__m128 v, float s) { return _mm_cmplt_ps(_mm_andnot_ps(_mm_set1_ps(-0.0f), v), _mm_set1_ps(s)); }
+        static __m128 Select(__m128 mask, __m128 a, __m128 b) { return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b)); }
+
+        // 4 consecutive vec4f's to (x, y, z, w) lanes and back
+        static void LoadPoints(const float* p, __m128& x, __m128& y, __m128& z, __m128& w)
+        {
+            x = Load(p);
+            y = Load(p + 4);
+            z = Load(p + 8);
+            w = Load(p + 12);
+            _MM_TRANSPOSE4_PS(x, y, z, w);
+        }
+
+        static void StorePoints(float* p, __m128 x, __m128 y, __m128 z, __m128 w)
+        {
+            _MM_TRANSPOSE4_PS(x, y, z, w);
+            Store(p, x);
+            Store(p + 4, y);
+            Store(p + 8, z);
+            Store(p + 12, w);
+        }
+    };
+#endif
+
+#if defined(MYGL_AVX)
+    template<>
+    struct FloatLanes<8>
+    {
+        static const size_t width = 8;
+
+        static __m256 Load(const float* p) { return _mm256_loadu_ps(p); }
+        static void Store(float* p, __m256 v) { _mm256_storeu_ps(p, v); }
+        static __m256 Splat(float s) { return _mm256_set1_ps(s); }
+
+        static __m256 AbsLess(__m256 v, float s) { return _mm256_cmp_ps(_mm256_andnot_ps(_mm256_set1_ps(-0.0f), v), _mm256_set1_ps(s), _CMP_LT_OQ); }
+        static __m256 Select(__m256 mask, __m256 a, __m256 b) { return _mm256_blendv_ps(b, a, mask); }
+
+        // 4x4 transpose within each 128-bit half
+        static void TransposeHalves(__m256& a, __m256& b, __m256& c, __m256& d)
+        {
+            __m256 t0 = _mm256_unpacklo_ps(a, b);
+            __m256 t1 = _mm256_unpackhi_ps(a, b);
+            __m256 t2 = _mm256_unpacklo_ps(c, d);
+            __m256 t3 = _mm256_unpackhi_ps(c, d);
+
+            a = _mm256_shuffle_ps(t0, t2, _MM_SHUFFLE(1, 0, 1, 0));
+            b = _mm256_shuffle_ps(t0, t2, _MM_SHUFFLE(3, 2, 3, 2));
+            c = _mm256_shuffle_ps(t1, t3, _MM_SHUFFLE(1, 0, 1, 0));
+            d = _mm256_shuffle_ps(t1, t3, _MM_SHUFFLE(3, 2, 3, 2));
+        }
+
+        // 8 consecutive vec4f's to (x, y, z, w) lanes and back; point i shares a register with point i + 4
+        static void LoadPoints(const float* p, __m256& x, __m256& y, __m256& z, __m256& w)
+        {
+            x = _mm256_insertf128_ps(_mm256_castps128_ps256(_mm_loadu_ps(p)), _mm_loadu_ps(p + 16), 1);
+            y = _mm256_insertf128_ps(_mm256_castps128_ps256(_mm_loadu_ps(p + 4)), _mm_loadu_ps(p + 20), 1);
+            z = _mm256_insertf128_ps(_mm256_castps128_ps256(_mm_loadu_ps(p + 8)), _mm_loadu_ps(p + 24), 1);
+            w = _mm256_insertf128_ps(_mm256_castps128_ps256(_mm_loadu_ps(p + 12)), _mm_loadu_ps(p + 28), 1);
+            TransposeHalves(x, y, z, w);
+        }
+
+        static void StorePoints(float* p, __m256 x, __m256 y, __m256 z, __m256 w)
+        {
+            TransposeHalves(x, y, z, w);
+            _mm_storeu_ps(p, _mm256_castps256_ps128(x));
+            _mm_storeu_ps(p + 4, _mm256_castps256_ps128(y));
+            _mm_storeu_ps(p + 8, _mm256_castps256_ps128(z));
+            _mm_storeu_ps(p + 12, _mm256_castps256_ps128(w));
+            _mm_storeu_ps(p + 16, _mm256_extractf128_ps(x, 1));
+            _mm_storeu_ps(p + 20, _mm256_extractf128_ps(y, 1));
+            _mm_storeu_ps(p + 24, _mm256_extractf128_ps(z, 1));
+            _mm_storeu_ps(p + 28, _mm256_extractf128_ps(w, 1));
+        }
+    };
+
+    using WidestFloatLanes = FloatLanes<8>;
+#elif defined(MYGL_SSE2)
+    using WidestFloatLanes = FloatLanes<4>;
+#endif
+
+#if defined(MYGL_SSE2)
+    // Transforms a batch of points held in (x, y, z, w) lanes; optionally followed by the perspective division and
+    // viewport mapping of ProjectPoints. Uses the same operation order as the scalar Multiply and Vector::operator/=.
+    template<typename L>
+    class PointTransform
+    {
+    public:
+        using V = decltype(L::Splat(0.0f));
+
+        PointTransform(const float* m, const float* viewport) : project_(viewport != nullptr)
+        {
+            for (int k = 0; k < 16; ++k)
+            {
+                m_[k] = L::Splat(m[k]);
+                viewport_[k] = L::Splat(project_ ? viewport[k] : 0.0f);
+            }
+        }
+
+        void Apply(V& x, V& y, V& z, V& w) const
+        {
+            Transform(m_, x, y, z, w);
+
+            if (project_)
+            {
+                // Vector::operator/= leaves the vector untouched when w is zero; dividing by 1 instead does the same
+                V d = L::Select(L::AbsLess(w, std::numeric_limits<float>::epsilon()), L::Splat(1.0f), w);
+
+                x = Div(x, d);
+                y = Div(y, d);
+                z = Div(z, d);
+                w = Div(w, d);
+
+                Transform(viewport_, x, y, z, w);
+            }
+        }
+
+        // Points [0, returned count) of an AoS batch, a whole number of register widths
+        size_t Run(const float* in, float* out, size_t n) const
+        {
+            size_t i = 0;
+
+            for (; i + L::width <= n; i += L::width)
+            {
+                V x, y, z, w;
+
+                L::LoadPoints(in + 4 * i, x, y, z, w);
+                Apply(x, y, z, w);
+                L::StorePoints(out + 4 * i, x, y, z, w);
+            }
+
+            return i;
+        }
+
+        // Same for an SoA batch
+        size_t Run(PointArrays<const float> in, PointArrays<float> out, size_t n) const
+        {
+            size_t i = 0;
+
+            for (; i + L::width <= n; i += L::width)
+            {
+                V x = L::Load(in.x + i);
+                V y = L::Load(in.y + i);
+                V z = L::Load(in.z + i);
+                V w = L::Load(in.w + i);
+
+                Apply(x, y, z, w);
+
+                L::Store(out.x + i, x);
+                L::Store(out.y + i, y);
+                L::Store(out.z + i, z);
+                L::Store(out.w + i, w);
+            }
+
+            return i;
+        }
+    private:
+        V m_[16];
+        V viewport_[16];
+        bool project_;
+
+        static void Transform(const V* m, V& x, V& y, V& z, V& w)
+        {
+            V nx = SumInOrder(Mul(m[0], x), Mul(m[1], y), Mul(m[2], z), Mul(m[3], w));
+            V ny = SumInOrder(Mul(m[4], x), Mul(m[5], y), Mul(m[6], z), Mul(m[7], w));
+            V nz = SumInOrder(Mul(m[8], x), Mul(m[9], y), Mul(m[10], z), Mul(m[11], w));
+            V nw = SumInOrder(Mul(m[12], x), Mul(m[13], y), Mul(m[14], z), Mul(m[15], w));
+
+            x = nx;
+            y = ny;
+            z = nz;
+            w = nw;
+        }
+    };
+#endif
+}
+
+#if defined(MYGL_SSE2)
+    inline float operator*(const Vector<float, 4>& a, const Vector<float, 4>& b)
+    {
+        return simd::Dot4(a.Data(), b.Data());
+    }
+
+    inline Vector<float, 4> Multiply(const SquareMatrix<float, 4>& a, const Vector<float, 4>& b)
+    {
+        Vector<float, 4> c;
+        simd::MultiplyVector4(a.Data(), b.Data(), c.Data());
+        return c;
+    }
+
+    inline SquareMatrix<float, 4> Multiply(const SquareMatrix<float, 4>& a, const SquareMatrix<float, 4>& b)
+    {
+        SquareMatrix<float, 4> c;
+        simd::MultiplyMatrix4(a.Data(), b.Data(), c.Data());
+        return c;
+    }
+
+    template<>
+    inline SquareMatrix<float, 4> SquareMatrix<float, 4>::Transpose() const
+    {
+        SquareMatrix<float, 4> t;
+        simd::Transpose4(Data(), t.Data());
+        return t;
+    }
+
+    inline Affine3<float> operator*(const Affine3<float>& a, const Affine3<float>& b)
+    {
+        Affine3<float> c;
+        simd::MultiplyAffine3(a.Data(), b.Data(), c.Data());
+        return c;
+    }
+
+    inline Vector<float, 4> operator*(const Affine3<float>& a, const Vector<float, 4>& v)
+    {
+        Vector<float, 4> c;
+        simd::MultiplyAffineVector3(a.Data(), v.Data(), c.Data());
+        return c;
+    }
+
+    template<>
+    inline const SquareMatrix<float, 4> Inverse4<float>(const SquareMatrix<float, 4>& m)
+    {
+        SquareMatrix<float, 4> im;
+        simd::Inverse4(m.Data(), im.Data());
+        return im;
+    }
+
+    // Batched transforms run 8 points at a time with AVX (4 with SSE2); the remainder goes through the scalar templates
+    inline void TransformPoints(const SquareMatrix<float, 4>& m, const Vector<float, 4>* in, Vector<float, 4>* out, size_t n)
+    {
+        MYGL_PROFILE_ZONE("TransformPoints");
+
+        simd::PointTransform<simd::WidestFloatLanes> t(m.Data(), nullptr);
+        size_t done = t.Run(reinterpret_cast<const float*>(in), reinterpret_cast<float*>(out), n);
+        TransformPoints<float>(m, in + done, out + done, n - done);
+    }
+
+    inline void TransformPoints(const SquareMatrix<float, 4>& m, PointArrays<const float> in, PointArrays<float> out, size_t n)
+    {
+        MYGL_PROFILE_ZONE("TransformPoints");
+
+        simd::PointTransform<simd::WidestFloatLanes> t(m.Data(), nullptr);
+        size_t done = t.Run(in, out, n);
+        TransformPoints<float>(m, {in.x + done, in.y + done, in.z + done, in.w + done}, {out.x + done, out.y + done, out.z + done, out.w + done}, n - done);
+    }
+
+    inline void ProjectPoints(const SquareMatrix<float, 4>& clip, const SquareMatrix<float, 4>& viewport, const Vector<float, 4>* in, Vector<float, 4>* out, size_t n)
+    {
+        MYGL_PROFILE_ZONE("ProjectPoints");
+
+        simd::PointTransform<simd::WidestFloatLanes> t(clip.Data(), viewport.Data());
+        size_t done = t.Run(reinterpret_cast<const float*>(in), reinterpret_cast<float*>(out), n);
+        ProjectPoints<float>(clip, viewport, in + done, out + done, n - done);
+    }
+
+    inline void ProjectPoints(const SquareMatrix<float, 4>& clip, const SquareMatrix<float, 4>& viewport, PointArrays<const float> in, PointArrays<float> out, size_t n)
+    {
+        MYGL_PROFILE_ZONE("ProjectPoints");
+
+        simd::PointTransform<simd::WidestFloatLanes> t(clip.Data(), viewport.Data());
+        size_t done = t.Run(in, out, n);
+        ProjectPoints<float>(clip, viewport, {in.x + done, in.y + done, in.z + done, in.w + done}, {out.x + done, out.y + done, out.z + done, out.w + done}, n - done);
+    }
+#endif
+
+#if defined(MYGL_AVX)
+    inline double operator*(const Vector<double, 4>& a, const Vector<double, 4>& b)
+    {
+        return simd::Dot4(a.Data(), b.Data());
+    }
+
+    inline Vector<double, 4> Multiply(const SquareMatrix<double, 4>& a, const Vector<double, 4>& b)
+    {
+        Vector<double, 4> c;
+        simd::MultiplyVector4(a.Data(), b.Data(), c.Data());
+        return c;
+    }
+
+    inline SquareMatrix<double, 4> Multiply(const SquareMatrix<double, 4>& a, const SquareMatrix<double, 4>& b)
+    {
+        SquareMatrix<double, 4> c;
+        simd::MultiplyMatrix4(a.Data(), b.Data(), c.Data());
+        return c;
+    }
+
+    template<>
+    inline SquareMatrix<double, 4> SquareMatrix<double, 4>::Transpose() const
+    {
+        SquareMatrix<double, 4> t;
+        simd::Transpose4(Data(), t.Data());
+        return t;
+    }
+
+    inline Affine3<double> operator*(const Affine3<double>& a, const Affine3<double>& b)
+    {
+        Affine3<double> c;
+        simd::MultiplyAffine3(a.Data(), b.Data(), c.Data());
+        return c;
+    }
+
+    inline Vector<double, 4> operator*(const Affine3<double>& a, const Vector<double, 4>& v)
+    {
+        Vector<double, 4> c;
+        simd::MultiplyAffineVector3(a.Data(), v.Data(), c.Data());
+        return c;
+    }
+#endif
+
+#if defined(MYGL_AVX2)
+    template<>
+    inline const SquareMatrix<double, 4> Inverse4<double>(const SquareMatrix<double, 4>& m)
+    {
+        SquareMatrix<double, 4> im;
+        simd::Inverse4(m.Data(), im.Data());
+        return im;
+    }
+#endif
+}
+
+#endif /* _LINALG_SIMD_H_ */
@@ -4,8 +4,21 @@
 #include <vector>
 #include <algorithm>
 #include <limits>
+#include <cstdint>
+#include <cstring>
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <new>
+#include <type_traits>
+#include <bitset>
+#include <chrono>
 
 #include "linalg.h"
+#include "allocstats.h"
 
 namespace mygl
 {
@@ -91,6 +104,443 @@ namespace mygl
 
     const float ZMIN = 1e-9; // cannot be less than zero
 
+    const int SUBPIXEL_BITS = 4; // the rasterizer snaps vertexes to 1/16 of a pixel
+    const int SUBPIXEL_ONE = 1 << SUBPIXEL_BITS;
+
+    // The fixed-point edge functions cannot overflow as long as every vertex lies within [-GUARD_BAND, GUARD_BAND] in x and y
+    const float GUARD_BAND = 4096.0f;
+
+    // Edge functions and depth plane of a triangle, computed once by SetupTriangle and then stepped by the rasterizer
+    struct TriangleSetup
+    {
+        // bounding box in pixels, clipped to the screen
+        int xmin, ymin, xmax, ymax;
+
+        // the pixel e and z are given for; the corner of the bounding box, which stays put when the box is clipped to a tile
+        int x0, y0;
+
+        // edge function i at pixel (x, y) is e[i] + (x - x0) * dx[i] + (y - y0) * dy[i], the pixel is covered if all three are >= 0
+        int e[3];
+        int dx[3];
+        int dy[3];
+
+        // z at the centre of pixel (x, y) is z + (x - x0) * dzdx + (y - y0) * dzdy
+        float z;
+        float dzdx;
+        float dzdy;
+    };
+
+    bool SetupTriangle(const vec3f& v1, const vec3f& v2, const vec3f& v3, int width, int height, TriangleSetup& setup);
+
+    // Calls plot(x, y, depth) for every pixel covered by the triangle
+    template<typename Plot>
+    void ScanTriangle(const TriangleSetup& s, Plot plot)
+    {
+        int e0row = s.e[0] + (s.xmin - s.x0) * s.dx[0] + (s.ymin - s.y0) * s.dy[0];
+        int e1row = s.e[1] + (s.xmin - s.x0) * s.dx[1] + (s.ymin - s.y0) * s.dy[1];
+        int e2row = s.e[2] + (s.xmin - s.x0) * s.dx[2] + (s.ymin - s.y0) * s.dy[2];
+
+        for (int y = s.ymin; y <= s.ymax; ++y)
+        {
+            int e0 = e0row;
+            int e1 = e1row;
+            int e2 = e2row;
+
+            // z is evaluated at integer offsets from (x0, y0) rather than accumulated, so a pixel gets the same depth
+            // no matter where the traversal started
+            float zrow = s.z + (y - s.y0) * s.dzdy;
+
+            for (int x = s.xmin; x <= s.xmax; ++x)
+            {
+                if ((e0 | e1 | e2) >= 0)
+                {
+                    float z = zrow + (x - s.x0) * s.dzdx;
+
+                    plot(x, y, 1.0f / z);
+                }
+
+                e0 += s.dx[0];
+                e1 += s.dx[1];
+                e2 += s.dx[2];
+            }
+
+            e0row += s.dy[0];
+            e1row += s.dy[1];
+            e2row += s.dy[2];
+        }
+    }
+
+    // A fixed set of threads that runs a job for every index in [0, n); the calling thread takes part as well
+    class WorkerPool
+    {
+    public:
+        explicit WorkerPool(int threads);
+        ~WorkerPool();
+
+        void Run(int n, const std::function<void(int)>& job); // returns when all n are done
+    private:
+        std::vector<std::thread> threads;
+
+        std::mutex m;
+        std::condition_variable wake;
+        std::condition_variable done;
+
+        const std::function<void(int)>* job = nullptr;
+        int n = 0;
+        std::atomic<int> next{0};
+        int busy = 0; // workers that have not finished the current run yet
+        unsigned generation = 0;
+        bool quit = false;
+
+        void Work();
+        void Drain();
+    };
+
+    WorkerPool::WorkerPool(int threads)
+    {
+        for (int i = 1; i < threads; ++i)
+        {
+            this->threads.emplace_back(&WorkerPool::Work, this);
+        }
+    }
+
+    WorkerPool::~WorkerPool()
+    {
+        {
+            std::lock_guard<std::mutex> lock(m);
+            quit = true;
+        }
+
+        wake.notify_all();
+
+        for (std::thread& t : threads)
+        {
+            t.join();
+        }
+    }
+
+    void WorkerPool::Run(int count, const std::function<void(int)>& f)
+    {
+        {
+            std::lock_guard<std::mutex> lock(m);
+
+            job = &f;
+            n = count;
+            next = 0;
+            busy = int(threads.size());
+            ++generation;
+        }
+
+        wake.notify_all();
+        Drain();
+
+        std::unique_lock<std::mutex> lock(m);
+        done.wait(lock, [this] { return busy == 0; });
+        job = nullptr;
+    }
+
+    void WorkerPool::Work()
+    {
+        MYGL_PROFILE_THREAD("WorkerPool");
+
+        unsigned seen = 0;
+
+        for (;;)
+        {
+            {
+                std::unique_lock<std::mutex> lock(m);
+                wake.wait(lock, [&] { return quit || generation != seen; });
+
+                if (quit) return;
+
+                seen = generation;
+            }
+
+            Drain();
+
+            std::lock_guard<std::mutex> lock(m);
+
+            if (--busy == 0)
+            {
+                done.notify_one();
+            }
+        }
+    }
+
+    void WorkerPool::Drain()
+    {
+        for (int i = next++; i < n; i = next++)
+        {
+            (*job)(i);
+        }
+    }
+
+    const int TILE_SIZE = 64; // in pixels, for binned rasterization
+    const int BIN_RESERVE = 64; // triangles every tile's bin has room for from the start, so that a frame rarely allocates
+    const int HIZ_BLOCK = 8; // in pixels, the depth bounds are kept per HIZ_BLOCK x HIZ_BLOCK block (TILE_SIZE must be a multiple)
+
+    /*
+        With MYGL_TILED_FRAMEBUFFER defined, pixels and zdepth are not stored row by row but TILE_SIZE x TILE_SIZE tile by
+        tile, each tile made of 8 x 8 micro-tiles (the HIZ_BLOCKs) in Morton order, each micro-tile row by row. A tile is
+        then 16 KB in one piece, and a micro-tile 4 cache lines, rather than 64 and 8 rows a whole screen width apart, which
+        pays off once the screen is much wider than the caches. Present turns it back into rows. The rasterizer and
+        PutPixel do the addressing; anything else that indexes pixels, zdepth or a buffer laid out like them must go
+        through PixelOffset.
+    */
+#if defined(MYGL_TILED_FRAMEBUFFER)
+    const bool TILED_FRAMEBUFFER = true;
+#else
+    const bool TILED_FRAMEBUFFER = false;
+#endif
+
+    static_assert(TILE_SIZE == 64 && HIZ_BLOCK == 8, "the tiled framebuffer addressing assumes 64 x 64 tiles of 8 x 8 micro-tiles");
+
+    // Index of pixel (x, y) in pixels and zdepth
+    inline int PixelOffset(int x, int y, int width)
+    {
+        if (!TILED_FRAMEBUFFER)
+        {
+            return y * width + x;
+        }
+
+        int tile = (y >> 6) * ((width + 63) >> 6) + (x >> 6);
+
+        // bits of the micro-tile's x and y interleaved, x first
+        int mx = (x >> 3) & 7;
+        int my = (y >> 3) & 7;
+        int micro = (mx & 1) | ((my & 1) << 1) | ((mx & 2) << 1) | ((my & 2) << 2) | ((mx & 4) << 2) | ((my & 4) << 3);
+
+        return (tile << 12) | (micro << 6) | ((y & 7) << 3) | (x & 7);
+    }
+
+    // Number of values in pixels and zdepth; a tiled framebuffer is padded to whole tiles
+    inline int FramebufferSize(int width, int height)
+    {
+        if (!TILED_FRAMEBUFFER)
+        {
+            return width * height;
+        }
+
+        return ((width + 63) >> 6) * ((height + 63) >> 6) * TILE_SIZE * TILE_SIZE;
+    }
+
+    /*
+        Fragment policies decide what happens to the pixels a primitive covers. They are template arguments of the Draw
+        functions, so everything is resolved at compile time and the kernels pay nothing for what a policy does not do.
+        The rasterizer looks at
+
+            DEPTH_TEST    only pixels nearer than zdepth pass, otherwise every covered pixel does
+            DEPTH_WRITE   passing pixels write their depth
+            COLOUR_WRITE  passing pixels write the colour
+
+        and calls Written(offset, bits, argb) for the passing pixels of a run of up to 8 pixels on a row, bit i standing
+        for pixels[offset + i]. Before that, a run that is depth tested pixel by pixel goes to Tested(offset, covered,
+        passed). Derive from DepthColourWrite and hide what should be different, eg. Written to keep an id per pixel, or
+        COLOUR_WRITE to blend in Written instead. Binned triangles keep a copy of their policy, so a policy must be
+        trivially copyable and no larger than two pointers.
+    */
+    struct DepthColourWrite
+    {
+        static constexpr bool DEPTH_TEST = true;
+        static constexpr bool DEPTH_WRITE = true;
+        static constexpr bool COLOUR_WRITE = true;
+
+        void Tested(int, unsigned, unsigned) const {}
+        void Written(int, unsigned, uint32_t) const {}
+    };
+
+    /*
+        With MYGL_FRAME_STATS defined, RendererBase3D counts what every frame costs, see GetFrameStats. Everything it does
+        for that is behind FRAME_STATS, which is a constant, so without MYGL_FRAME_STATS the counting is compiled away. The
+        timers add a call to the clock per triangle drawn, so the stage times are slightly inflated.
+    */
+#if defined(MYGL_FRAME_STATS)
+    const bool FRAME_STATS = true;
+#else
+    const bool FRAME_STATS = false;
+#endif
+
+    struct FrameStats
+    {
+        // Filled triangles
+        int submitted = 0;  // given to DrawFilledTriangleBarycentric, DrawFilledTriangleClip or DrawModel
+        int culled = 0;     // dropped before the rasterizer: outside of the view volume, facing away (cullMode) or too small or far out to cover a pixel
+        int clipped = 0;    // cut against the near plane or the guard band, the pieces go on to the rasterizer
+        int rasterized = 0; // reached the rasterizer, as TrianglesDrawn
+
+        // Pixels, including PutPixel's and the lines'
+        int64_t tested = 0;   // depth tested one by one; blocks the hierarchical z rejects or accepts as a whole are not
+        int64_t rejected = 0; // failed that test
+        int64_t written = 0;
+        double overdraw = 0;  // written per pixel on the screen
+
+        // Wall time in milliseconds. The tiles that are cleared lazily while drawing count as raster, binning and Flush
+        // as well; vertex is what DrawModel and DrawFilledTriangleClip spend before the rasterizer; present is what
+        // Present does after Flush and the clears
+        double clearMs = 0;
+        double vertexMs = 0;
+        double rasterMs = 0;
+        double presentMs = 0;
+    };
+
+    const int STATS_HISTORY = 240; // frames kept by FrameStatsHistory
+
+    // The last STATS_HISTORY frames' stats, oldest first
+    class FrameStatsHistory
+    {
+    public:
+        void Add(const FrameStats& stats);
+
+        int Frames() const; // up to STATS_HISTORY
+        const FrameStats& operator[](int i) const;
+
+        // How many of the frames have value(stats) in each of bins equal parts of [lo, hi); values outside go to the
+        // first or the last bin
+        template<typename Value>
+        std::vector<int> Histogram(Value value, double lo, double hi, int bins) const;
+
+        template<typename Value>
+        double Percentile(Value value, double p) const; // p in [0, 100]
+    private:
+        FrameStats frames[STATS_HISTORY];
+        int next = 0;
+        int count = 0;
+    };
+
+    void FrameStatsHistory::Add(const FrameStats& stats)
+    {
+        frames[next] = stats;
+        next = (next + 1) % STATS_HISTORY;
+        count = std::min(count + 1, STATS_HISTORY);
+    }
+
+    int FrameStatsHistory::Frames() const
+    {
+        return count;
+    }
+
+    const FrameStats& FrameStatsHistory::operator[](int i) const
+    {
+        return frames[(next - count + i + STATS_HISTORY) % STATS_HISTORY];
+    }
+
+    template<typename Value>
+    std::vector<int> FrameStatsHistory::Histogram(Value value, double lo, double hi, int bins) const
+    {
+        std::vector<int> histogram(bins);
+
+        for (int i = 0; i < count; ++i)
+        {
+            int bin = int((value((*this)[i]) - lo) / (hi - lo) * bins);
+
+            ++histogram[std::min(std::max(bin, 0), bins - 1)];
+        }
+
+        return histogram;
+    }
+
+    template<typename Value>
+    double FrameStatsHistory::Percentile(Value value, double p) const
+    {
+        if (count == 0) return 0;
+
+        std::vector<double> values(count);
+
+        for (int i = 0; i < count; ++i)
+        {
+            values[i] = value((*this)[i]);
+        }
+
+        std::sort(values.begin(), values.end());
+
+        return values[std::min(count - 1, int(p / 100 * count))];
+    }
+
+    // The pixel counts of FrameStats, kept apart where several threads rasterize
+    struct PixelCounts
+    {
+        int64_t tested = 0;
+        int64_t rejected = 0;
+        int64_t written = 0;
+    };
+
+    // Counts the pixels for FrameStats and hands everything on to the policy it wraps
+    template<typename Fragments>
+    struct CountFragments : Fragments
+    {
+        PixelCounts* counts;
+
+        CountFragments(const Fragments& fragments, PixelCounts* counts) : Fragments(fragments), counts(counts) {}
+
+        void Tested(int offset, unsigned covered, unsigned passed) const
+        {
+            counts->tested += std::bitset<32>(covered).count();
+            counts->rejected += std::bitset<32>(covered & ~passed).count();
+
+            Fragments::Tested(offset, covered, passed);
+        }
+
+        void Written(int offset, unsigned bits, uint32_t argb) const
+        {
+            counts->written += std::bitset<32>(bits).count();
+
+            Fragments::Written(offset, bits, argb);
+        }
+    };
+
+    // Adds the time from construction to destruction to *stage, less what is added to *nested meanwhile; does nothing for
+    // a null stage
+    class StageTimer
+    {
+    public:
+        explicit StageTimer(double* stage, const double* nested = nullptr)
+          : stage(stage), nested(nested)
+        {
+            if (stage)
+            {
+                nestedStart = nested ? *nested : 0;
+                start = std::chrono::steady_clock::now();
+            }
+        }
+
+        ~StageTimer()
+        {
+            if (stage)
+            {
+                *stage += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+                *stage -= nested ? *nested - nestedStart : 0;
+            }
+        }
+    private:
+        double* stage;
+        const double* nested;
+        double nestedStart = 0;
+        std::chrono::steady_clock::time_point start;
+    };
+
+    // Writes the covered pixels that pass the depth test, or all of them if depthTest is false, as the fragment policy
+    // says; the SIMD kernels and the dispatch are in mygl_simd.h
+    template<typename Fragments>
+    using RasterKernel = void (*)(const TriangleSetup& setup, uint32_t argb, uint32_t* pixels, float* zdepth, int width, bool depthTest, const Fragments& fragments);
+
+    template<typename Fragments>
+    RasterKernel<Fragments> GetRasterKernel(); // the fastest kernel the CPU supports
+    const char* GetRasterKernelName();
+
+    // Sets n values starting at dst; with stream, bypasses the cache where the CPU can (for memory that is not read soon)
+    void FillBuffer(uint32_t* dst, uint32_t value, int n, bool stream);
+    void FillFence(); // orders streamed stores before whatever comes next, eg. handing the buffer to another thread
+
+    void ResolveTiles(const uint32_t* tiled, uint32_t* linear, int width, int height); // tiled framebuffer to rows
+
+    // Which triangles DrawModel and DrawModelFaces drop by their winding on screen; front faces go clockwise as seen by the viewer
+    enum class CullMode
+    {
+        NONE,
+        BACK,
+        FRONT
+    };
+
     // Platform indepentent base class for programs that use 3D graphics
     class RendererBase3D
     {
@@ -102,127 +552,1449 @@ namespace mygl
         virtual void Init() = 0;
         virtual void Update() = 0;
         virtual void Render() = 0;
+
+        // With threads > 0, triangles are binned into TILE_SIZE x TILE_SIZE screen tiles as they are submitted and rasterized
+        // tile by tile on that many threads once the frame is presented (or something else is drawn). Each tile has a single
+        // owner, so the framebuffer needs no locks, and the result is the same as drawing the triangles one by one. 0 (the
+        // default) draws every triangle right away
+        void SetRasterThreads(int threads);
+
+        // Finishes the frame and returns its pixels, width * height BGRA values for SDL_UpdateTexture or any other consumer.
+        // pixels and zdepth are only up to date after Present, see ClearScreen
+        const uint32_t* Present();
+
+        // What ClearScreen clears to; the depth must be <= every depth that is drawn (ZMIN by default)
+        void SetClearColour(const Colour& colour);
+        void SetClearDepth(float depth);
+
+        int TrianglesDrawn() const; // filled triangles that reached the rasterizer since ClearScreen
+
+        // Only with MYGL_FRAME_STATS: the stats of the frame that the last Present finished (what was drawn since the
+        // Present before), and of the frames before it
+        const FrameStats& GetFrameStats() const;
+        const FrameStatsHistory& GetFrameStatsHistory() const;
     protected:
         int width;
         int height;
 
-        std::vector<uint32_t> pixels;
+        std::vector<uint32_t> pixels; // FramebufferSize(width, height) values, pixel (x, y) is at PixelOffset(x, y, width)
         std::vector<float> zdepth;
 
+        // Hierarchical z: bounds on the zdepth values in each HIZ_BLOCK x HIZ_BLOCK block, hizMin[i] <= zdepth <= hizMax[i].
+        // Anything that writes zdepth must keep them valid
+        int blocksX;
+        int blocksY;
+        std::vector<float> hizMin;
+        std::vector<float> hizMax;
+
+        // Maps clip space to the screen after the division by w, for the Clip functions. By default x and y go from [-1, 1]
+        // to the whole screen (y flipped) and z from [-1, 1] to [0.5, width + 0.5]
+        mat4f viewport;
+
+        CullMode cullMode = CullMode::BACK; // for DrawModel and DrawModelFaces, the other Draw functions draw both windings
+
         /* Coordinate system:
            x goes right starting from top left corner
            y goes down starting from top left corner
            z goes into page starting from top left corner
          */
-        void DrawFilledTriangleBarycentric(const vec3f& v1, const vec3f& v2, const vec3f& v3, const Colour& colour); // Warning: vertexes might need to be arranged in clockwise direction
-        void DrawWireframeTriangleDDA(const vec3f& v1, const vec3f& v2, const vec3f& v3, const Colour& colour);
-        void DrawLineDDA(const vec3f& v1, const vec3f& v2, const Colour& colour);
+        template<typename Fragments = DepthColourWrite>
+        void DrawFilledTriangleBarycentric(const vec3f& v1, const vec3f& v2, const vec3f& v3, const Colour& colour, const Fragments& fragments = Fragments()); // either winding; vertexes outside the guard band are not drawn
+        template<typename Fragments = DepthColourWrite>
+        void DrawWireframeTriangle(const vec3f& v1, const vec3f& v2, const vec3f& v3, const Colour& colour, const Fragments& fragments = Fragments());
+        template<typename Fragments = DepthColourWrite>
+        void DrawLine(const vec3f& v1, const vec3f& v2, const Colour& colour, const Fragments& fragments = Fragments()); // clipped to the screen
+        template<typename Fragments = DepthColourWrite>
+        void DrawLineAA(const vec3f& v1, const vec3f& v2, const Colour& colour, const Fragments& fragments = Fragments()); // antialiased, blends into the pixels
+
+        // Clip space (after the projection) versions of the above: what is behind the near plane is clipped away, the rest is
+        // divided by w, mapped by viewport and drawn, so perspective projections work as well
+        template<typename Fragments = DepthColourWrite>
+        void DrawFilledTriangleClip(const vec4f& c1, const vec4f& c2, const vec4f& c3, const Colour& colour, const Fragments& fragments = Fragments());
+        template<typename Fragments = DepthColourWrite>
+        void DrawWireframeTriangleClip(const vec4f& c1, const vec4f& c2, const vec4f& c3, const Colour& colour, const Fragments& fragments = Fragments());
+        template<typename Fragments = DepthColourWrite>
+        void DrawLineClip(const vec4f& c1, const vec4f& c2, const Colour& colour, const Fragments& fragments = Fragments());
+
+        // Draws a model placed in the world by modelm and seen through projection. Every vertex is transformed once, then
+        // the triangles are put together from their indexes, culled according to cullMode and lit by light (a unit vector
+        // in world space, pointing towards the light)
+        template<typename Fragments = DepthColourWrite>
+        void DrawModel(const Model& model, const affine3f& modelm, const mat4f& projection, const vec3f& light, const Fragments& fragments = Fragments());
+
+        // As DrawModel, but faces(i, colour, fragments) is called first for every triangle i with copies of its colour and
+        // of fragments to change for it, eg. to colour the faces of a model that is drawn several times; the triangle is
+        // dropped if it returns false
+        template<typename Fragments, typename Faces>
+        void DrawModelFaces(const Model& model, const affine3f& modelm, const mat4f& projection, const vec3f& light, const Fragments& fragments, Faces faces);
 
-        virtual void PutPixel(int x, int y, float depth, uint32_t argb); // can be optionally overriden
+        template<typename Fragments = DepthColourWrite>
+        void PutPixel(int x, int y, float depth, uint32_t argb, const Fragments& fragments = Fragments());
 
+        // Clears lazily: a TILE_SIZE x TILE_SIZE tile that was drawn into is only cleared when something is drawn into it
+        // again, or by Present if nothing is, and tiles that still hold the clear values are not touched at all
         void ClearScreen();
+
+        void Flush(); // draws the binned triangles
+    private:
+        struct BinnedTriangle
+        {
+            TriangleSetup setup;
+            uint32_t argb;
+
+            // Rasterize for the triangle's fragment policy, which is kept in fragments
+            void (*rasterize)(RendererBase3D& renderer, const TriangleSetup& setup, uint32_t argb, const void* fragments, PixelCounts& counts);
+            alignas(void*) unsigned char fragments[2 * sizeof(void*)];
+        };
+
+        std::unique_ptr<WorkerPool> workers; // only while binning
+
+        int tilesX;
+        int tilesY;
+
+        std::vector<BinnedTriangle> binned; // this frame's triangles, in submission order
+        std::vector<std::vector<int>> bins; // per tile, indexes into binned
+        std::vector<int> activeTiles; // tiles with a non-empty bin
+
+        enum
+        {
+            TILE_CLEAR, // holds the clear values
+            TILE_DRAWN, // drawn into since the last ClearScreen
+            TILE_STALE  // drawn into before the last ClearScreen, has to be cleared before it is used
+        };
+
+        std::vector<uint8_t> tileState;
+
+        uint32_t clearColour = 0;
+        float clearDepth = ZMIN;
+
+        int trianglesDrawn = 0;
+
+        FrameStats stats; // the frame being drawn
+        FrameStats lastStats;
+        FrameStatsHistory statsHistory;
+        PixelCounts pixelCounts; // for everything drawn on this thread
+        std::vector<PixelCounts> tileCounts; // for the binned triangles, per tile
+
+        double* Stage(double FrameStats::* stage) { return FRAME_STATS ? &(stats.*stage) : nullptr; } // for StageTimer
+        void FinishFrameStats();
+
+        std::vector<uint32_t> presented; // the pixels row by row, for a tiled framebuffer
+
+        void PrepareTiles(int xmin, int ymin, int xmax, int ymax); // clears the stale tiles that overlap the rectangle and marks them drawn
+        void ClearStaleTiles(); // for Present, with streamed stores; FillFence must follow
+        void ClearTile(int tile, bool stream);
+
+        template<typename Fragments>
+        void Bin(const TriangleSetup& setup, uint32_t argb, const Fragments& fragments);
+        template<typename Fragments>
+        static void RasterizeBinned(RendererBase3D& renderer, const TriangleSetup& setup, uint32_t argb, const void* fragments, PixelCounts& counts);
+        template<typename Fragments>
+        void RasterizeCounted(const TriangleSetup& setup, uint32_t argb, const Fragments& fragments, PixelCounts& counts); // counts only with FRAME_STATS
+        template<typename Fragments>
+        void Rasterize(const TriangleSetup& setup, uint32_t argb, RasterKernel<Fragments> kernel, const Fragments& fragments);
+        void TouchDepth(int x, int y, float depth); // keeps the depth bounds valid after zdepth was written outside of Rasterize
+
+        template<typename Fragments>
+        void PutPixelAA(int x, int y, float depth, uint32_t argb, float coverage, const Fragments& fragments);
+
+        vec3f ToScreen(const vec4f& c) const; // divide by w and apply viewport
+
+        // DrawFilledTriangleBarycentric and DrawFilledTriangleClip without counting the triangle as submitted, for the Draw
+        // functions that use them
+        template<typename Fragments>
+        void DrawTriangle(const vec3f& v1, const vec3f& v2, const vec3f& v3, const Colour& colour, const Fragments& fragments);
+        template<typename Fragments>
+        void DrawTriangleClip(const vec4f& c1, const vec4f& c2, const vec4f& c3, const Colour& colour, const Fragments& fragments);
+
+        void CountPixel(bool tested, bool passed); // for FrameStats, a pixel drawn on its own
+
+        // DrawModel's transformed vertexes, kept between calls so that drawing does not allocate
+        std::vector<vec4f> worldVertexes;
+        std::vector<vec4f> clipVertexes;
+        std::vector<vec3f> screenVertexes;
+        std::vector<unsigned> vertexCodes;
     };
 
     RendererBase3D::RendererBase3D(int width, int height)
-      : width(width), height(height), pixels(width * height), zdepth(width * height)
-    {}
+      : width(width), height(height),
+        blocksX((width + HIZ_BLOCK - 1) / HIZ_BLOCK), blocksY((height + HIZ_BLOCK - 1) / HIZ_BLOCK),
+        tilesX((width + TILE_SIZE - 1) / TILE_SIZE), tilesY((height + TILE_SIZE - 1) / TILE_SIZE)
+    {
+        MYGL_ALLOC_CATEGORY(FRAMEBUFFER);
+
+        pixels.resize(FramebufferSize(width, height));
+        zdepth.resize(FramebufferSize(width, height));
+        hizMin.resize(blocksX * blocksY);
+        hizMax.resize(blocksX * blocksY);
+        tileState.resize(tilesX * tilesY, TILE_STALE);
+        presented.resize(TILED_FRAMEBUFFER ? width * height : 0);
+
+        viewport = {{width / 2.0f, 0,             0,            width / 2.0f},
+                    {0,            -height / 2.0f, 0,            height / 2.0f},
+                    {0,            0,             width / 2.0f, width / 2.0f + 0.5f},
+                    {0,            0,             0,            1}};
+    }
 
     RendererBase3D::~RendererBase3D()
     {}
 
-    // https://austinmorlan.com/posts/drawing_a_triangle/
-    // TODO https://fgiesen.wordpress.com/2013/02/10/optimizing-the-basic-rasterizer/
-    void RendererBase3D::DrawFilledTriangleBarycentric(const vec3f& v1, const vec3f& v2, const vec3f& v3, const Colour& colour)
-    {
-        // Area of the parallelogram formed by edge vectors
-        float area = (v3[0] - v1[0]) * (v2[1] - v1[1]) - (v3[1] - v1[1]) * (v2[0] - v1[0]);
+    /*
+        https://fgiesen.wordpress.com/2013/02/08/triangle-rasterization-in-practice/
+        https://fgiesen.wordpress.com/2013/02/10/optimizing-the-basic-rasterizer/
+
+        The vertexes are snapped to 28.4 fixed point, the edge functions are evaluated at pixel centres and the top-left
+        fill rule is applied by biasing the edges that are neither top nor left edges by one, so that a pixel centre lying
+        exactly on an edge shared by two triangles is only drawn by one of them.
 
-        // top left and bottom right points of a bounding box
-        float xmin = std::min({v1[0], v2[0], v3[0]});
-        float xmax = std::max({v1[0], v2[0], v3[0]});
-        float ymin = std::min({v1[1], v2[1], v3[1]});
-        float ymax = std::max({v1[1], v2[1], v3[1]});
+        Edge function E of a vertex pair (a, b) at a pixel centre p is (bx - ax) * (py - ay) - (by - ay) * (px - ax) in
+        1/256 of a pixel. Moving by one pixel changes E by a multiple of 16, so E >= 0 iff (E0 >> 4) + k >= 0 where E0 is
+        the value at the first pixel and k the sum of the per pixel steps; that keeps the per pixel work in 32 bit integers.
 
-        // basic clipping
-        int x1 = std::max(int(std::floor(xmin)), 0);
-        int x2 = std::min(int(std::floor(xmax)), width - 1);
-        int y1 = std::max(int(std::floor(ymin)), 0);
-        int y2 = std::min(int(std::floor(ymax)), height - 1);
+        Returns false if there is nothing to draw (degenerate, off screen or outside the guard band)
+    */
+    bool SetupTriangle(const vec3f& v1, const vec3f& v2, const vec3f& v3, int width, int height, TriangleSetup& setup)
+    {
+        const vec3f* v[3] = {&v1, &v2, &v3};
+
+        int x[3];
+        int y[3];
 
-        for (int y = y1; y <= y2; ++y)
+        for (int i = 0; i < 3; ++i)
         {
-            for (int x = x1; x <= x2; ++x)
+            float vx = (*v[i])[0];
+            float vy = (*v[i])[1];
+
+            // also rejects NaN
+            if (!(vx >= -GUARD_BAND && vx <= GUARD_BAND && vy >= -GUARD_BAND && vy <= GUARD_BAND))
             {
-                float px = x + 0.5f;
-                float py = y + 0.5f;
+                return false;
+            }
 
-                // Barycentric weights
-                float w1 = ((px - v2[0]) * (v3[1] - v2[1]) - (py - v2[1]) * (v3[0] - v2[0])) / area;
-                float w2 = ((px - v3[0]) * (v1[1] - v3[1]) - (py - v3[1]) * (v1[0] - v3[0])) / area;
-                float w3 = ((px - v1[0]) * (v2[1] - v1[1]) - (py - v1[1]) * (v2[0] - v1[0])) / area;
+            x[i] = int(std::floor(vx * SUBPIXEL_ONE + 0.5f));
+            y[i] = int(std::floor(vy * SUBPIXEL_ONE + 0.5f));
+        }
 
-                if ((w1 >= 0.0f) & (w2 >= 0.0f) & (w3 >= 0.0f))
-                {
-                    float z = w1 * v1[2] + w2 * v2[2] + w3 * v3[2];
-                    float depth = 1.0f / z;
+        int64_t area = int64_t(x[1] - x[0]) * (y[2] - y[0]) - int64_t(y[1] - y[0]) * (x[2] - x[0]);
 
-                    PutPixel(x, y, depth, colour.argb);
-                }
-            }
+        if (area == 0)
+        {
+            return false;
         }
-    }
 
-    void RendererBase3D::DrawWireframeTriangleDDA(const vec3f& v1, const vec3f& v2, const vec3f& v3, const Colour& colour)
-    {
-        // TODO check bounds
-        DrawLineDDA(v1, v2, colour);
-        DrawLineDDA(v1, v3, colour);
-        DrawLineDDA(v2, v3, colour);
-    }
+        // both windings are drawn; make it positive so that the inside of the triangle is where all edge functions are >= 0
+        if (area < 0)
+        {
+            std::swap(v[1], v[2]);
+            std::swap(x[1], x[2]);
+            std::swap(y[1], y[2]);
+        }
 
-    // TODO integer DDA might be faster
-    void RendererBase3D::DrawLineDDA(const vec3f& v1, const vec3f& v2, const Colour& colour)
-    {
-        float dx = v2[0] - v1[0];
-        float dy = v2[1] - v1[1];
-        float dz = v2[2] - v1[2];
+        // first and last pixel whose centre (16 * x + 8) is inside the bounding box
+        setup.xmin = std::max((std::min({x[0], x[1], x[2]}) - SUBPIXEL_ONE / 2 + SUBPIXEL_ONE - 1) >> SUBPIXEL_BITS, 0);
+        setup.xmax = std::min((std::max({x[0], x[1], x[2]}) - SUBPIXEL_ONE / 2) >> SUBPIXEL_BITS, width - 1);
+        setup.ymin = std::max((std::min({y[0], y[1], y[2]}) - SUBPIXEL_ONE / 2 + SUBPIXEL_ONE - 1) >> SUBPIXEL_BITS, 0);
+        setup.ymax = std::min((std::max({y[0], y[1], y[2]}) - SUBPIXEL_ONE / 2) >> SUBPIXEL_BITS, height - 1);
 
-        float step = std::fabs(dx) >= std::fabs(dy) ? std::fabs(dx) : std::fabs(dy);
+        if (setup.xmin > setup.xmax || setup.ymin > setup.ymax)
+        {
+            return false;
+        }
 
-        dx /= step;
-        dy /= step;
-        dz /= step;
+        setup.x0 = setup.xmin;
+        setup.y0 = setup.ymin;
 
-        float x = v1[0];
-        float y = v1[1];
-        float z = v1[2];
+        int px = (setup.x0 << SUBPIXEL_BITS) + SUBPIXEL_ONE / 2;
+        int py = (setup.y0 << SUBPIXEL_BITS) + SUBPIXEL_ONE / 2;
 
-        for (int i = 0; i <= step; ++i)
+        for (int i = 0; i < 3; ++i)
         {
-            PutPixel(x, y, 1.0f / z, colour.argb);
+            int a = i;
+            int b = (i + 1) % 3;
 
-            x += dx;
-            y += dy;
-            z += dz;
+            int dx = x[b] - x[a];
+            int dy = y[b] - y[a];
+
+            // top edge: horizontal with the inside below it, left edge: going up with the inside to its right
+            bool topLeft = dy < 0 || (dy == 0 && dx > 0);
+
+            int64_t e = int64_t(dx) * (py - y[a]) - int64_t(dy) * (px - x[a]) - (topLeft ? 0 : 1);
+
+            setup.e[i] = int(e >> SUBPIXEL_BITS);
+            setup.dx[i] = -dy;
+            setup.dy[i] = dx;
         }
+
+        // z is affine in screen space (1/z is not), so it is the plane through the snapped vertexes that gets interpolated
+        float x0 = float(x[0]) / SUBPIXEL_ONE;
+        float y0 = float(y[0]) / SUBPIXEL_ONE;
+        float x1 = float(x[1]) / SUBPIXEL_ONE - x0;
+        float y1 = float(y[1]) / SUBPIXEL_ONE - y0;
+        float x2 = float(x[2]) / SUBPIXEL_ONE - x0;
+        float y2 = float(y[2]) / SUBPIXEL_ONE - y0;
+        float z0 = (*v[0])[2];
+        float z1 = (*v[1])[2] - z0;
+        float z2 = (*v[2])[2] - z0;
+        float det = x1 * y2 - y1 * x2;
+
+        setup.dzdx = (z1 * y2 - z2 * y1) / det;
+        setup.dzdy = (z2 * x1 - z1 * x2) / det;
+        setup.z = z0 + (setup.x0 + 0.5f - x0) * setup.dzdx + (setup.y0 + 0.5f - y0) * setup.dzdy;
+
+        return true;
+    }
+
+    template<typename Fragments>
+    void RendererBase3D::DrawFilledTriangleBarycentric(const vec3f& v1, const vec3f& v2, const vec3f& v3, const Colour& colour, const Fragments& fragments)
+    {
+        MYGL_PROFILE_ZONE("RendererBase3D::DrawFilledTriangleBarycentric");
+
+        if (FRAME_STATS) ++stats.submitted;
+
+        DrawTriangle(v1, v2, v3, colour, fragments);
     }
 
-    void RendererBase3D::PutPixel(int x, int y, float depth, uint32_t argb)
+    template<typename Fragments>
+    void RendererBase3D::DrawTriangle(const vec3f& v1, const vec3f& v2, const vec3f& v3, const Colour& colour, const Fragments& fragments)
     {
-        int offset = y * width + x;
+        StageTimer timer(Stage(&FrameStats::rasterMs));
+
+        TriangleSetup s;
 
-        if (zdepth[offset] < depth)
+        if (!SetupTriangle(v1, v2, v3, width, height, s))
         {
-            zdepth[offset] = depth;
-            pixels[offset] = argb;
+            if (FRAME_STATS) ++stats.culled;
+            return;
+        }
+
+        ++trianglesDrawn;
+
+        if (FRAME_STATS) ++stats.rasterized;
+
+        if (workers)
+        {
+            Bin(s, colour.argb, fragments);
+        }
+        else
+        {
+            RasterizeCounted(s, colour.argb, fragments, pixelCounts);
         }
     }
 
-    void RendererBase3D::ClearScreen()
+    enum
     {
-        std::fill(zdepth.begin(), zdepth.end(), ZMIN);
-        std::fill(pixels.begin(), pixels.end(), 0);
-    }
-}
+        CLIP_LEFT = 1,
+        CLIP_RIGHT = 2,
+        CLIP_BOTTOM = 4,
+        CLIP_TOP = 8,
+        CLIP_NEAR = 16,
+        CLIP_GUARD_BAND = 32 // not a plane: the vertex is off the guard band on screen (or behind the near plane)
+    };
+
+    const int CLIP_MAX = 16; // vertexes of a clipped triangle, clipping against 5 planes leaves at most 8
+
+    // Outcode of a clip space vertex: which of the planes x = -w, x = w, y = -w, y = w and z = -w (near) it is outside of
+    inline unsigned ClipCodes(const vec4f& v)
+    {
+        unsigned codes = 0;
+
+        if (v[0] < -v[3]) codes |= CLIP_LEFT;
+        if (v[0] > v[3]) codes |= CLIP_RIGHT;
+        if (v[1] < -v[3]) codes |= CLIP_BOTTOM;
+        if (v[1] > v[3]) codes |= CLIP_TOP;
+        if (v[2] < -v[3]) codes |= CLIP_NEAR;
+
+        return codes;
+    }
+
+    // Sutherland-Hodgman: writes the part of the convex polygon in[0..n) where plane * v >= 0 to out (at most CLIP_MAX
+    // vertexes) and returns its number of vertexes
+    inline int ClipPolygon(const vec4f* in, int n, const vec4f& plane, vec4f* out)
+    {
+        int m = 0;
+
+        for (int i = 0; i < n && m + 2 <= CLIP_MAX; ++i)
+        {
+            const vec4f& a = in[i];
+            const vec4f& b = in[(i + 1) % n];
+
+            float da = plane * a;
+            float db = plane * b;
+
+            if (da >= 0.0f)
+            {
+                out[m++] = a;
+            }
+
+            if ((da >= 0.0f) != (db >= 0.0f))
+            {
+                out[m++] = a + (b - a) * (da / (da - db));
+            }
+        }
+
+        return m;
+    }
+
+    inline bool InsideGuardBand(const vec3f& v) // false for NaN
+    {
+        return std::fabs(v[0]) <= GUARD_BAND && std::fabs(v[1]) <= GUARD_BAND;
+    }
+
+    vec3f RendererBase3D::ToScreen(const vec4f& c) const
+    {
+        vec4f v = c;
+
+        v /= v[3];
+
+        return (viewport * v).Demote();
+    }
+
+    /*
+        Triangles entirely outside of one of the frustum's sides or behind the near plane are dropped by their outcodes. Of
+        the rest, those in front of the near plane that stay within the rasterizer's guard band, which is nearly all of
+        them, are drawn as they are: there is no need to clip against the sides of the screen since the rasterizer only
+        looks at the pixels on it. Only triangles crossing the near plane (whose w would go through zero and make the
+        division by w meaningless) or leaving the guard band are clipped, against the near plane and against the guard
+        band's sides given in clip space, and drawn as a fan.
+    */
+    template<typename Fragments>
+    void RendererBase3D::DrawFilledTriangleClip(const vec4f& c1, const vec4f& c2, const vec4f& c3, const Colour& colour, const Fragments& fragments)
+    {
+        MYGL_PROFILE_ZONE("RendererBase3D::DrawFilledTriangleClip");
+
+        StageTimer timer(Stage(&FrameStats::vertexMs), &stats.rasterMs);
+
+        if (FRAME_STATS) ++stats.submitted;
+
+        DrawTriangleClip(c1, c2, c3, colour, fragments);
+    }
+
+    template<typename Fragments>
+    void RendererBase3D::DrawTriangleClip(const vec4f& c1, const vec4f& c2, const vec4f& c3, const Colour& colour, const Fragments& fragments)
+    {
+        unsigned codes1 = ClipCodes(c1);
+        unsigned codes2 = ClipCodes(c2);
+        unsigned codes3 = ClipCodes(c3);
+
+        if (codes1 & codes2 & codes3)
+        {
+            if (FRAME_STATS) ++stats.culled;
+            return;
+        }
+
+        if (!((codes1 | codes2 | codes3) & CLIP_NEAR))
+        {
+            vec3f s1 = ToScreen(c1);
+            vec3f s2 = ToScreen(c2);
+            vec3f s3 = ToScreen(c3);
+
+            if (InsideGuardBand(s1) && InsideGuardBand(s2) && InsideGuardBand(s3))
+            {
+                DrawTriangle(s1, s2, s3, colour, fragments);
+                return;
+            }
+        }
+
+        if (FRAME_STATS) ++stats.clipped;
+
+        // screen x (y) is (viewport row 0 (1) * c) / w, so -g <= x <= g is row * c + g * w >= 0 and g * w - row * c >= 0;
+        // both also need w > 0
+        const float g = GUARD_BAND - 1.0f;
+
+        vec4f row0 = viewport[0];
+        vec4f row1 = viewport[1];
+
+        const vec4f planes[5] = {
+            vec4f(0.0f, 0.0f, 1.0f, 1.0f), // near: z + w >= 0
+            row0 + vec4f(0.0f, 0.0f, 0.0f, g),
+            vec4f(0.0f, 0.0f, 0.0f, g) - row0,
+            row1 + vec4f(0.0f, 0.0f, 0.0f, g),
+            vec4f(0.0f, 0.0f, 0.0f, g) - row1,
+        };
+
+        vec4f polygon[CLIP_MAX] = {c1, c2, c3};
+        vec4f clipped[CLIP_MAX];
+
+        int n = 3;
+
+        for (const vec4f& plane : planes)
+        {
+            n = ClipPolygon(polygon, n, plane, clipped);
+            std::copy(clipped, clipped + n, polygon);
+        }
+
+        vec3f screen[CLIP_MAX];
+
+        for (int i = 0; i < n; ++i)
+        {
+            screen[i] = ToScreen(polygon[i]);
+        }
+
+        for (int i = 1; i + 1 < n; ++i)
+        {
+            DrawTriangle(screen[0], screen[i], screen[i + 1], colour, fragments);
+        }
+    }
+
+    template<typename Fragments>
+    void RendererBase3D::DrawWireframeTriangleClip(const vec4f& c1, const vec4f& c2, const vec4f& c3, const Colour& colour, const Fragments& fragments)
+    {
+        DrawLineClip(c1, c2, colour, fragments);
+        DrawLineClip(c1, c3, colour, fragments);
+        DrawLineClip(c2, c3, colour, fragments);
+    }
+
+    // Only the near plane needs clipping, DrawLine clips to the screen
+    template<typename Fragments>
+    void RendererBase3D::DrawLineClip(const vec4f& c1, const vec4f& c2, const Colour& colour, const Fragments& fragments)
+    {
+        float d1 = c1[2] + c1[3];
+        float d2 = c2[2] + c2[3];
+
+        if (!(d1 >= 0.0f || d2 >= 0.0f))
+        {
+            return;
+        }
+
+        vec4f a = d1 >= 0.0f ? c1 : c1 + (c2 - c1) * (d1 / (d1 - d2));
+        vec4f b = d2 >= 0.0f ? c2 : c1 + (c2 - c1) * (d1 / (d1 - d2));
+
+        DrawLine(ToScreen(a), ToScreen(b), colour, fragments);
+    }
+
+    /*
+        The vertexes go through the batched TransformPoints, then each gets its outcode and, if it is in front of the near
+        plane, its screen position. A triangle whose vertexes are all within the guard band goes straight to the
+        rasterizer, only the others are left to DrawFilledTriangleClip.
+    */
+    template<typename Fragments>
+    void RendererBase3D::DrawModel(const Model& model, const affine3f& modelm, const mat4f& projection, const vec3f& light, const Fragments& fragments)
+    {
+        DrawModelFaces(model, modelm, projection, light, fragments, [](int, Colour&, Fragments&) { return true; });
+    }
+
+    template<typename Fragments, typename Faces>
+    void RendererBase3D::DrawModelFaces(const Model& model, const affine3f& modelm, const mat4f& projection, const vec3f& light, const Fragments& fragments, Faces faces)
+    {
+        MYGL_PROFILE_ZONE("RendererBase3D::DrawModel");
+
+        StageTimer timer(Stage(&FrameStats::vertexMs), &stats.rasterMs);
+
+        int n = model.nvert;
+
+        {
+            MYGL_ALLOC_CATEGORY(VECTOR);
+
+            worldVertexes.resize(n);
+            clipVertexes.resize(n);
+            screenVertexes.resize(n);
+            vertexCodes.resize(n);
+        }
+
+        // screen y might be flipped (it is by default), which turns the winding around
+        float flip = viewport[0][0] * viewport[1][1] - viewport[0][1] * viewport[1][0] < 0.0f ? -1.0f : 1.0f;
+
+        TransformPoints(modelm.ToMatrix4(), model.vertex, worldVertexes.data(), n);
+        TransformPoints(projection, worldVertexes.data(), clipVertexes.data(), n);
+
+        for (int i = 0; i < n; ++i)
+        {
+            unsigned codes = ClipCodes(clipVertexes[i]);
+
+            if (!(codes & CLIP_NEAR))
+            {
+                screenVertexes[i] = ToScreen(clipVertexes[i]);
+            }
+
+            if ((codes & CLIP_NEAR) || !InsideGuardBand(screenVertexes[i]))
+            {
+                codes |= CLIP_GUARD_BAND;
+            }
+
+            vertexCodes[i] = codes;
+        }
+
+        for (int i = 0; i < model.ntrig; ++i)
+        {
+            const Triangle& t = model.triangle[i];
+
+            Colour colour = t.colour;
+            Fragments triangleFragments = fragments;
+
+            if (!faces(i, colour, triangleFragments)) continue;
+
+            int i1 = t.vertex[0];
+            int i2 = t.vertex[1];
+            int i3 = t.vertex[2];
+
+            unsigned codes1 = vertexCodes[i1];
+            unsigned codes2 = vertexCodes[i2];
+            unsigned codes3 = vertexCodes[i3];
+
+            if (FRAME_STATS && t.filled) ++stats.submitted;
+
+            // outside of the same frustum plane
+            if (codes1 & codes2 & codes3 & ~CLIP_GUARD_BAND)
+            {
+                if (FRAME_STATS && t.filled) ++stats.culled;
+                continue;
+            }
+
+            if (cullMode != CullMode::NONE)
+            {
+                const vec4f& c1 = clipVertexes[i1];
+                const vec4f& c2 = clipVertexes[i2];
+                const vec4f& c3 = clipVertexes[i3];
+
+                // the determinant of the clip space (x, y, w) is the signed area on screen times w1 * w2 * w3 (and the
+                // viewport's scale), and it gives the winding even when some vertexes are behind the near plane
+                float area = flip * (c1[0] * (c2[1] * c3[3] - c3[1] * c2[3]) -
+                                     c2[0] * (c1[1] * c3[3] - c3[1] * c1[3]) +
+                                     c3[0] * (c1[1] * c2[3] - c2[1] * c1[3]));
+
+                if (cullMode == CullMode::BACK ? !(area > 0.0f) : !(area < 0.0f))
+                {
+                    if (FRAME_STATS && t.filled) ++stats.culled;
+                    continue;
+                }
+            }
+
+            // only the triangles left get a normal
+            vec3f w1 = worldVertexes[i1].Demote();
+            vec3f w2 = worldVertexes[i2].Demote();
+            vec3f w3 = worldVertexes[i3].Demote();
+
+            float L = std::max(CrossProduct(w3 - w1, w2 - w1).Unit() * light, 0.0f);
+
+            if (!t.filled)
+            {
+                DrawWireframeTriangleClip(clipVertexes[i1], clipVertexes[i2], clipVertexes[i3], colour, triangleFragments);
+            }
+            else if (!((codes1 | codes2 | codes3) & CLIP_GUARD_BAND))
+            {
+                DrawTriangle(screenVertexes[i1], screenVertexes[i2], screenVertexes[i3], colour.AdjustBrightness(L), triangleFragments);
+            }
+            else
+            {
+                DrawTriangleClip(clipVertexes[i1], clipVertexes[i2], clipVertexes[i3], colour.AdjustBrightness(L), triangleFragments);
+            }
+        }
+    }
+
+    inline int FloorDiv(int a, int b) // b > 0
+    {
+        return a >= 0 ? a / b : -((-a + b - 1) / b);
+    }
+
+    template<typename Fragments>
+    void RendererBase3D::RasterizeCounted(const TriangleSetup& s, uint32_t argb, const Fragments& fragments, PixelCounts& counts)
+    {
+        if (FRAME_STATS)
+        {
+            Rasterize(s, argb, GetRasterKernel<CountFragments<Fragments>>(), CountFragments<Fragments>(fragments, &counts));
+        }
+        else
+        {
+            Rasterize(s, argb, GetRasterKernel<Fragments>(), fragments);
+        }
+    }
+
+    /*
+        Goes through the triangle block by block. Since z is affine, its range over a block is given by the corners, and
+        so is the range of depth = 1 / z when z > 0; a block where the triangle's largest depth does not exceed hizMin is
+        hidden and skipped, a block that the triangle covers completely with its smallest depth above hizMax is written
+        without depth tests. Either way the pixels come out the same as with a depth test per pixel. Neighbouring blocks on
+        a row that are handled the same way go to the kernel together.
+
+        Without DEPTH_TEST every block the triangle touches is written, and the bounds are widened to take its depths in.
+        Without DEPTH_WRITE the bounds stay as they are.
+    */
+    template<typename Fragments>
+    void RendererBase3D::Rasterize(const TriangleSetup& s, uint32_t argb, RasterKernel<Fragments> kernel, const Fragments& fragments)
+    {
+        enum { SKIP, TEST, WRITE };
+
+        PrepareTiles(s.xmin, s.ymin, s.xmax, s.ymax);
+
+        float xoff = float(std::max(std::abs(s.xmin - s.x0), std::abs(s.xmax - s.x0)) + 1);
+        float yoff = float(std::max(std::abs(s.ymin - s.y0), std::abs(s.ymax - s.y0)) + 1);
+
+        // bound on the rounding error of z as computed by the kernels, generously
+        float eps = (std::fabs(s.z) + std::fabs(s.dzdx) * xoff + std::fabs(s.dzdy) * yoff) * 1e-5f;
+
+        TriangleSetup run = s;
+
+        for (int by = s.ymin / HIZ_BLOCK; by <= s.ymax / HIZ_BLOCK; ++by)
+        {
+            int blockYmin = by * HIZ_BLOCK;
+            int blockYmax = std::min(blockYmin + HIZ_BLOCK - 1, height - 1);
+
+            int ymin = std::max(s.ymin, blockYmin);
+            int ymax = std::min(s.ymax, blockYmax);
+
+            bool rowCovered = ymin == blockYmin && ymax == blockYmax;
+
+            // what does not change along the row: edge functions and z at the row's top, and their range over the rows
+            int erow[3];
+            int eylo[3];
+            int eyhi[3];
+
+            for (int i = 0; i < 3; ++i)
+            {
+                erow[i] = s.e[i] + (ymin - s.y0) * s.dy[i];
+                eylo[i] = std::min((ymax - ymin) * s.dy[i], 0);
+                eyhi[i] = std::max((ymax - ymin) * s.dy[i], 0);
+            }
+
+            // the span of pixels on these rows that can be inside every edge, no need to look at blocks outside of it
+            int xl = s.xmin;
+            int xr = s.xmax;
+
+            for (int i = 0; i < 3; ++i)
+            {
+                // the edge function at x is at most best + (x - x0) * dx
+                int best = erow[i] + eyhi[i];
+
+                if (s.dx[i] > 0)
+                {
+                    xl = std::max(xl, s.x0 - FloorDiv(best, s.dx[i]));
+                }
+                else if (s.dx[i] < 0)
+                {
+                    xr = std::min(xr, s.x0 + FloorDiv(best, -s.dx[i]));
+                }
+                else if (best < 0)
+                {
+                    xr = xl - 1;
+                }
+            }
+
+            float zrow = s.z + (ymin - s.y0) * s.dzdy;
+            float zylo = std::min((ymax - ymin) * s.dzdy, 0.0f) - eps;
+            float zyhi = std::max((ymax - ymin) * s.dzdy, 0.0f) + eps;
+
+            run.ymin = ymin;
+            run.ymax = ymax;
+
+            int runAction = SKIP;
+
+            for (int bx = xl / HIZ_BLOCK; bx <= xr / HIZ_BLOCK && xl <= xr; ++bx)
+            {
+                int blockXmin = bx * HIZ_BLOCK;
+                int blockXmax = std::min(blockXmin + HIZ_BLOCK - 1, width - 1);
+
+                int xmin = std::max(s.xmin, blockXmin);
+                int xmax = std::min(s.xmax, blockXmax);
+
+                // the edge functions at the corners of the part of the block inside the bounding box
+                bool outside = false;
+                bool covered = rowCovered && xmin == blockXmin && xmax == blockXmax;
+
+                for (int i = 0; i < 3; ++i)
+                {
+                    int e = erow[i] + (xmin - s.x0) * s.dx[i];
+                    int ex = (xmax - xmin) * s.dx[i];
+
+                    outside |= e + std::max(ex, 0) + eyhi[i] < 0;
+                    covered &= e + std::min(ex, 0) + eylo[i] >= 0;
+                }
+
+                int action = TEST;
+
+                if (outside)
+                {
+                    action = SKIP;
+                }
+                else
+                {
+                    float z = zrow + (xmin - s.x0) * s.dzdx;
+                    float zx = (xmax - xmin) * s.dzdx;
+
+                    float zlo = z + std::min(zx, 0.0f) + zylo;
+                    float zhi = z + std::max(zx, 0.0f) + zyhi;
+
+                    int block = by * blocksX + bx;
+
+                    // when z crosses zero the depths are not bounded
+                    bool bounded = zlo > 0.0f;
+
+                    float dmax = bounded ? 1.0f / zlo : std::numeric_limits<float>::infinity();
+                    float dmin = bounded ? 1.0f / zhi : -std::numeric_limits<float>::infinity();
+
+                    if (!Fragments::DEPTH_TEST)
+                    {
+                        action = WRITE;
+
+                        if (Fragments::DEPTH_WRITE)
+                        {
+                            hizMin[block] = covered ? dmin : std::min(hizMin[block], dmin);
+                            hizMax[block] = covered ? dmax : std::max(hizMax[block], dmax);
+                        }
+                    }
+                    else if (dmax <= hizMin[block])
+                    {
+                        action = SKIP;
+                    }
+                    else if (covered && dmin > hizMax[block])
+                    {
+                        action = WRITE;
+
+                        if (Fragments::DEPTH_WRITE)
+                        {
+                            hizMin[block] = dmin;
+                            hizMax[block] = dmax;
+                        }
+                    }
+                    else if (Fragments::DEPTH_WRITE)
+                    {
+                        hizMax[block] = std::max(hizMax[block], dmax);
+
+                        if (covered)
+                        {
+                            hizMin[block] = std::max(hizMin[block], dmin);
+                        }
+                    }
+                }
+
+                if (action != runAction)
+                {
+                    if (runAction != SKIP)
+                    {
+                        kernel(run, argb, &pixels[0], &zdepth[0], width, runAction == TEST, fragments);
+                    }
+
+                    runAction = action;
+                    run.xmin = xmin;
+                }
+
+                run.xmax = xmax;
+            }
+
+            if (runAction != SKIP)
+            {
+                kernel(run, argb, &pixels[0], &zdepth[0], width, runAction == TEST, fragments);
+            }
+        }
+    }
+
+    void RendererBase3D::TouchDepth(int x, int y, float depth)
+    {
+        int block = (y / HIZ_BLOCK) * blocksX + x / HIZ_BLOCK;
+
+        // also catches NaN
+        if (!(depth <= hizMax[block]))
+        {
+            hizMax[block] = std::isnan(depth) ? std::numeric_limits<float>::infinity() : depth;
+        }
+
+        if (!(depth >= hizMin[block]))
+        {
+            hizMin[block] = std::isnan(depth) ? -std::numeric_limits<float>::infinity() : depth;
+        }
+    }
+
+    void RendererBase3D::SetRasterThreads(int threads)
+    {
+        Flush();
+
+        if (threads > 0)
+        {
+            workers.reset(new WorkerPool(threads));
+
+            MYGL_ALLOC_CATEGORY(FRAMEBUFFER);
+
+            bins.resize(tilesX * tilesY);
+            tileCounts.resize(tilesX * tilesY);
+
+            for (std::vector<int>& bin : bins)
+            {
+                bin.reserve(BIN_RESERVE);
+            }
+
+            binned.reserve(BIN_RESERVE * 4);
+            activeTiles.reserve(tilesX * tilesY);
+        }
+        else
+        {
+            workers.reset();
+        }
+    }
+
+    const uint32_t* RendererBase3D::Present()
+    {
+        MYGL_PROFILE_ZONE("RendererBase3D::Present");
+
+        Flush();
+        ClearStaleTiles();
+
+        const uint32_t* result = &pixels[0];
+
+        {
+            StageTimer timer(Stage(&FrameStats::presentMs));
+
+            FillFence();
+
+            if (TILED_FRAMEBUFFER)
+            {
+                ResolveTiles(&pixels[0], &presented[0], width, height);
+
+                result = &presented[0];
+            }
+        }
+
+        if (FRAME_STATS)
+        {
+            FinishFrameStats();
+        }
+
+        return result;
+    }
+
+    void RendererBase3D::ClearStaleTiles()
+    {
+        StageTimer timer(Stage(&FrameStats::clearMs));
+
+        int tiles = tilesX * tilesY;
+        int stale = int(std::count(tileState.begin(), tileState.end(), uint8_t(TILE_STALE)));
+
+        // the tiles left stale get the clear values; nothing reads them before the next frame, so the stores bypass the
+        // cache, and if that is all of them the buffers are filled in one go
+        if (stale == tiles)
+        {
+            uint32_t depthBits;
+            std::memcpy(&depthBits, &clearDepth, sizeof depthBits);
+
+            FillBuffer(&pixels[0], clearColour, int(pixels.size()), true);
+            FillBuffer(reinterpret_cast<uint32_t*>(&zdepth[0]), depthBits, int(zdepth.size()), true);
+
+            std::fill(hizMin.begin(), hizMin.end(), clearDepth);
+            std::fill(hizMax.begin(), hizMax.end(), clearDepth);
+            std::fill(tileState.begin(), tileState.end(), uint8_t(TILE_CLEAR));
+        }
+        else if (stale > 0)
+        {
+            for (int tile = 0; tile < tiles; ++tile)
+            {
+                if (tileState[tile] == TILE_STALE)
+                {
+                    ClearTile(tile, true);
+                }
+            }
+        }
+    }
+
+    void RendererBase3D::SetClearColour(const Colour& colour)
+    {
+        Flush();
+
+        clearColour = colour.argb;
+
+        // what was clear is not anymore
+        std::replace(tileState.begin(), tileState.end(), uint8_t(TILE_CLEAR), uint8_t(TILE_STALE));
+    }
+
+    void RendererBase3D::SetClearDepth(float depth)
+    {
+        Flush();
+
+        clearDepth = depth;
+
+        std::replace(tileState.begin(), tileState.end(), uint8_t(TILE_CLEAR), uint8_t(TILE_STALE));
+    }
+
+    int RendererBase3D::TrianglesDrawn() const
+    {
+        return trianglesDrawn;
+    }
+
+    const FrameStats& RendererBase3D::GetFrameStats() const
+    {
+        return lastStats;
+    }
+
+    const FrameStatsHistory& RendererBase3D::GetFrameStatsHistory() const
+    {
+        return statsHistory;
+    }
+
+    void RendererBase3D::FinishFrameStats()
+    {
+        for (PixelCounts& counts : tileCounts)
+        {
+            pixelCounts.tested += counts.tested;
+            pixelCounts.rejected += counts.rejected;
+            pixelCounts.written += counts.written;
+
+            counts = PixelCounts();
+        }
+
+        stats.tested = pixelCounts.tested;
+        stats.rejected = pixelCounts.rejected;
+        stats.written = pixelCounts.written;
+        stats.overdraw = double(stats.written) / (double(width) * height);
+
+        lastStats = stats;
+        statsHistory.Add(stats);
+
+        stats = FrameStats();
+        pixelCounts = PixelCounts();
+    }
+
+    void RendererBase3D::CountPixel(bool tested, bool passed)
+    {
+        pixelCounts.tested += tested;
+        pixelCounts.rejected += tested && !passed;
+        pixelCounts.written += passed;
+    }
+
+    void RendererBase3D::PrepareTiles(int xmin, int ymin, int xmax, int ymax)
+    {
+        for (int ty = ymin / TILE_SIZE; ty <= ymax / TILE_SIZE; ++ty)
+        {
+            for (int tx = xmin / TILE_SIZE; tx <= xmax / TILE_SIZE; ++tx)
+            {
+                int tile = ty * tilesX + tx;
+
+                if (tileState[tile] == TILE_STALE)
+                {
+                    ClearTile(tile, false); // about to be drawn into, so it should stay in the cache
+                }
+
+                tileState[tile] = TILE_DRAWN;
+            }
+        }
+    }
+
+    void RendererBase3D::ClearTile(int tile, bool stream)
+    {
+        int x0 = (tile % tilesX) * TILE_SIZE;
+        int y0 = (tile / tilesX) * TILE_SIZE;
+        int x1 = std::min(x0 + TILE_SIZE, width);
+        int y1 = std::min(y0 + TILE_SIZE, height);
+
+        uint32_t depthBits;
+        std::memcpy(&depthBits, &clearDepth, sizeof depthBits);
+
+        if (TILED_FRAMEBUFFER)
+        {
+            FillBuffer(&pixels[tile * TILE_SIZE * TILE_SIZE], clearColour, TILE_SIZE * TILE_SIZE, stream);
+            FillBuffer(reinterpret_cast<uint32_t*>(&zdepth[tile * TILE_SIZE * TILE_SIZE]), depthBits, TILE_SIZE * TILE_SIZE, stream);
+        }
+        else
+        {
+            for (int y = y0; y < y1; ++y)
+            {
+                FillBuffer(&pixels[y * width + x0], clearColour, x1 - x0, stream);
+                FillBuffer(reinterpret_cast<uint32_t*>(&zdepth[y * width + x0]), depthBits, x1 - x0, stream);
+            }
+        }
+
+        // tiles are made of whole blocks
+        for (int by = y0 / HIZ_BLOCK; by < (y1 + HIZ_BLOCK - 1) / HIZ_BLOCK; ++by)
+        {
+            for (int bx = x0 / HIZ_BLOCK; bx < (x1 + HIZ_BLOCK - 1) / HIZ_BLOCK; ++bx)
+            {
+                hizMin[by * blocksX + bx] = clearDepth;
+                hizMax[by * blocksX + bx] = clearDepth;
+            }
+        }
+
+        tileState[tile] = TILE_CLEAR;
+    }
+
+    template<typename Fragments>
+    void RendererBase3D::Bin(const TriangleSetup& s, uint32_t argb, const Fragments& fragments)
+    {
+        static_assert(std::is_trivially_copyable<Fragments>::value && sizeof(Fragments) <= sizeof(BinnedTriangle::fragments) &&
+                      alignof(Fragments) <= alignof(void*), "binned fragment policies must be trivially copyable and small");
+
+        MYGL_ALLOC_CATEGORY(FRAMEBUFFER);
+
+        int index = int(binned.size());
+
+        binned.push_back({s, argb, RasterizeBinned<Fragments>, {}});
+        ::new (static_cast<void*>(binned.back().fragments)) Fragments(fragments);
+
+        for (int ty = s.ymin / TILE_SIZE; ty <= s.ymax / TILE_SIZE; ++ty)
+        {
+            int y0 = std::max(ty * TILE_SIZE, s.ymin);
+            int y1 = std::min(ty * TILE_SIZE + TILE_SIZE - 1, s.ymax);
+
+            for (int tx = s.xmin / TILE_SIZE; tx <= s.xmax / TILE_SIZE; ++tx)
+            {
+                int x0 = std::max(tx * TILE_SIZE, s.xmin);
+                int x1 = std::min(tx * TILE_SIZE + TILE_SIZE - 1, s.xmax);
+
+                // skip the tile if it is entirely outside of an edge, ie. the edge function is negative even at the corner where it is largest
+                bool outside = false;
+
+                for (int i = 0; i < 3; ++i)
+                {
+                    int x = s.dx[i] > 0 ? x1 : x0;
+                    int y = s.dy[i] > 0 ? y1 : y0;
+
+                    outside |= s.e[i] + (x - s.x0) * s.dx[i] + (y - s.y0) * s.dy[i] < 0;
+                }
+
+                if (outside) continue;
+
+                int tile = ty * tilesX + tx;
+
+                if (bins[tile].empty())
+                {
+                    activeTiles.push_back(tile);
+                }
+
+                bins[tile].push_back(index);
+            }
+        }
+    }
+
+    template<typename Fragments>
+    void RendererBase3D::RasterizeBinned(RendererBase3D& renderer, const TriangleSetup& s, uint32_t argb, const void* fragments, PixelCounts& counts)
+    {
+        renderer.RasterizeCounted(s, argb, *static_cast<const Fragments*>(fragments), counts);
+    }
+
+    void RendererBase3D::Flush()
+    {
+        if (binned.empty()) return;
+
+        MYGL_PROFILE_ZONE("RendererBase3D::Flush");
+
+        StageTimer timer(Stage(&FrameStats::rasterMs));
+
+        workers->Run(int(activeTiles.size()), [this](int i)
+        {
+            MYGL_PROFILE_ZONE("RendererBase3D::Flush tile");
+
+            int tile = activeTiles[i];
+            int tx = tile % tilesX;
+            int ty = tile / tilesX;
+
+            for (int index : bins[tile])
+            {
+                const BinnedTriangle& t = binned[index];
+
+                // only the bounding box changes, so every pixel comes out exactly as it would without binning; tiles are
+                // made of whole depth bound blocks, so those have a single owner too
+                TriangleSetup s = t.setup;
+
+                s.xmin = std::max(s.xmin, tx * TILE_SIZE);
+                s.xmax = std::min(s.xmax, tx * TILE_SIZE + TILE_SIZE - 1);
+                s.ymin = std::max(s.ymin, ty * TILE_SIZE);
+                s.ymax = std::min(s.ymax, ty * TILE_SIZE + TILE_SIZE - 1);
+
+                t.rasterize(*this, s, t.argb, t.fragments, tileCounts[tile]);
+            }
+
+            bins[tile].clear();
+        });
+
+        activeTiles.clear();
+        binned.clear();
+    }
+
+    template<typename Fragments>
+    void RendererBase3D::DrawWireframeTriangle(const vec3f& v1, const vec3f& v2, const vec3f& v3, const Colour& colour, const Fragments& fragments)
+    {
+        DrawLine(v1, v2, colour, fragments);
+        DrawLine(v1, v3, colour, fragments);
+        DrawLine(v2, v3, colour, fragments);
+    }
+
+    /*
+        Liang-Barsky: clips the segment a-b to [0, xmax] x [0, ymax], z is interpolated along. Returns false if nothing is
+        left, or if the segment is not finite
+    */
+    bool ClipLine(vec3f& a, vec3f& b, float xmax, float ymax)
+    {
+        if (!(std::isfinite(a[0]) && std::isfinite(a[1]) && std::isfinite(b[0]) && std::isfinite(b[1])))
+        {
+            return false;
+        }
+
+        float dx = b[0] - a[0];
+        float dy = b[1] - a[1];
+
+        // the segment is inside of boundary i where q[i] - t * p[i] >= 0
+        float p[4] = {-dx, dx, -dy, dy};
+        float q[4] = {a[0], xmax - a[0], a[1], ymax - a[1]};
+
+        float t0 = 0.0f;
+        float t1 = 1.0f;
+
+        for (int i = 0; i < 4; ++i)
+        {
+            if (p[i] == 0.0f)
+            {
+                if (q[i] < 0.0f) return false; // parallel to the boundary and outside of it
+            }
+            else
+            {
+                float t = q[i] / p[i];
+
+                if (p[i] < 0.0f)
+                {
+                    t0 = std::max(t0, t); // entering
+                }
+                else
+                {
+                    t1 = std::min(t1, t); // leaving
+                }
+            }
+        }
+
+        if (!(t0 <= t1))
+        {
+            return false;
+        }
+
+        vec3f d = b - a;
+
+        b = a + d * t1;
+        a = a + d * t0;
+
+        return true;
+    }
+
+    // dst + (src - dst) * coverage per channel
+    inline uint32_t BlendARGB(uint32_t dst, uint32_t src, float coverage)
+    {
+        uint32_t result = 0;
+
+        for (int shift = 0; shift < 32; shift += 8)
+        {
+            float d = float((dst >> shift) & 0xff);
+            float s = float((src >> shift) & 0xff);
+
+            result |= uint32_t(d + (s - d) * coverage + 0.5f) << shift;
+        }
+
+        return result;
+    }
+
+    /*
+        Bresenham's algorithm on the part of the line that is on the screen. Pixel (x, y) is the square [x, x + 1) x
+        [y, y + 1) as for triangles, so the endpoints are moved to pixel centre coordinates before they are clipped and
+        rounded. z steps along with the major axis and 1 / z is the depth, as for triangles.
+    */
+    template<typename Fragments>
+    void RendererBase3D::DrawLine(const vec3f& v1, const vec3f& v2, const Colour& colour, const Fragments& fragments)
+    {
+        MYGL_PROFILE_ZONE("RendererBase3D::DrawLine");
+
+        Flush();
+
+        StageTimer timer(Stage(&FrameStats::rasterMs));
+
+        vec3f a(v1[0] - 0.5f, v1[1] - 0.5f, v1[2]);
+        vec3f b(v2[0] - 0.5f, v2[1] - 0.5f, v2[2]);
+
+        if (!ClipLine(a, b, width - 1.0f, height - 1.0f))
+        {
+            return;
+        }
+
+        int x = int(std::floor(a[0] + 0.5f));
+        int y = int(std::floor(a[1] + 0.5f));
+        int x1 = int(std::floor(b[0] + 0.5f));
+        int y1 = int(std::floor(b[1] + 0.5f));
+
+        int dx = std::abs(x1 - x);
+        int dy = -std::abs(y1 - y);
+        int sx = x < x1 ? 1 : -1;
+        int sy = y < y1 ? 1 : -1;
+        int err = dx + dy;
+
+        int steps = std::max(dx, -dy);
+
+        float z = a[2];
+        float dz = steps > 0 ? (b[2] - a[2]) / steps : 0.0f;
+
+        for (int i = 0; i <= steps; ++i)
+        {
+            PutPixel(x, y, 1.0f / z, colour.argb, fragments);
+
+            int e2 = 2 * err;
+
+            if (e2 >= dy)
+            {
+                err += dy;
+                x += sx;
+            }
+
+            if (e2 <= dx)
+            {
+                err += dx;
+                y += sy;
+            }
+
+            z += dz;
+        }
+    }
+
+    /*
+        Xiaolin Wu's algorithm: for every step along the major axis the line covers the two pixels next to it on the minor
+        axis in proportion to how close it passes to their centres. Both are depth tested and blended into the pixels,
+        only the one covered more writes its depth. Clipping and depth are as in DrawLine.
+    */
+    template<typename Fragments>
+    void RendererBase3D::DrawLineAA(const vec3f& v1, const vec3f& v2, const Colour& colour, const Fragments& fragments)
+    {
+        MYGL_PROFILE_ZONE("RendererBase3D::DrawLineAA");
+
+        Flush();
+
+        StageTimer timer(Stage(&FrameStats::rasterMs));
+
+        vec3f a(v1[0] - 0.5f, v1[1] - 0.5f, v1[2]);
+        vec3f b(v2[0] - 0.5f, v2[1] - 0.5f, v2[2]);
+
+        if (!ClipLine(a, b, width - 1.0f, height - 1.0f))
+        {
+            return;
+        }
+
+        // walk along x; a steep line is walked along y with the axes swapped
+        bool steep = std::fabs(b[1] - a[1]) > std::fabs(b[0] - a[0]);
+
+        if (steep)
+        {
+            a = vec3f(a[1], a[0], a[2]);
+            b = vec3f(b[1], b[0], b[2]);
+        }
+
+        if (a[0] > b[0])
+        {
+            std::swap(a, b);
+        }
+
+        int x0 = int(std::floor(a[0] + 0.5f));
+        int x1 = int(std::floor(b[0] + 0.5f));
+        int minorMax = (steep ? width : height) - 1;
+
+        float run = b[0] - a[0];
+        float gradient = run > 0.0f ? (b[1] - a[1]) / run : 0.0f;
+        float dzdx = run > 0.0f ? (b[2] - a[2]) / run : 0.0f;
+
+        // the minor coordinate and z where the line crosses the centre of column x0
+        float y = a[1] + (x0 - a[0]) * gradient;
+        float z = a[2] + (x0 - a[0]) * dzdx;
+
+        for (int x = x0; x <= x1; ++x)
+        {
+            // the ends of a column can be up to half a pixel past the clipped line
+            float yc = std::min(std::max(y, 0.0f), float(minorMax));
+
+            int lo = int(yc);
+            int hi = lo + 1;
+            float f = yc - lo;
+            float depth = 1.0f / z;
+
+            if (steep)
+            {
+                PutPixelAA(lo, x, depth, colour.argb, 1.0f - f, fragments);
+                if (hi <= minorMax && f > 0.0f) PutPixelAA(hi, x, depth, colour.argb, f, fragments);
+            }
+            else
+            {
+                PutPixelAA(x, lo, depth, colour.argb, 1.0f - f, fragments);
+                if (hi <= minorMax && f > 0.0f) PutPixelAA(x, hi, depth, colour.argb, f, fragments);
+            }
+
+            y += gradient;
+            z += dzdx;
+        }
+    }
+
+    template<typename Fragments>
+    void RendererBase3D::PutPixelAA(int x, int y, float depth, uint32_t argb, float coverage, const Fragments& fragments)
+    {
+        Flush(); // the binned triangles were submitted before this pixel
+
+        int offset = PixelOffset(x, y, width);
+
+        PrepareTiles(x, y, x, y);
+
+        bool passed = !Fragments::DEPTH_TEST || zdepth[offset] < depth;
+
+        if (Fragments::DEPTH_TEST) fragments.Tested(offset, 1, passed);
+        if (FRAME_STATS) CountPixel(Fragments::DEPTH_TEST, passed);
+
+        if (!passed)
+        {
+            return;
+        }
+
+        uint32_t blended = BlendARGB(pixels[offset], argb, coverage);
+
+        if (Fragments::DEPTH_WRITE && coverage >= 0.5f)
+        {
+            zdepth[offset] = depth;
+            TouchDepth(x, y, depth);
+        }
+
+        if (Fragments::COLOUR_WRITE)
+        {
+            pixels[offset] = blended;
+        }
+
+        fragments.Written(offset, 1, blended);
+    }
+
+    template<typename Fragments>
+    void RendererBase3D::PutPixel(int x, int y, float depth, uint32_t argb, const Fragments& fragments)
+    {
+        Flush(); // the binned triangles were submitted before this pixel
+
+        int offset = PixelOffset(x, y, width);
+
+        PrepareTiles(x, y, x, y);
+
+        bool passed = !Fragments::DEPTH_TEST || zdepth[offset] < depth;
+
+        if (Fragments::DEPTH_TEST) fragments.Tested(offset, 1, passed);
+        if (FRAME_STATS) CountPixel(Fragments::DEPTH_TEST, passed);
+
+        if (passed)
+        {
+            if (Fragments::DEPTH_WRITE)
+            {
+                zdepth[offset] = depth;
+                TouchDepth(x, y, depth);
+            }
+
+            if (Fragments::COLOUR_WRITE)
+            {
+                pixels[offset] = argb;
+            }
+
+            fragments.Written(offset, 1, argb);
+        }
+    }
+
+    void RendererBase3D::ClearScreen()
+    {
+        MYGL_PROFILE_ZONE("RendererBase3D::ClearScreen");
+
+        StageTimer timer(Stage(&FrameStats::clearMs));
+
+        // whatever was binned would be cleared anyway
+        for (int tile : activeTiles)
+        {
+            bins[tile].clear();
+        }
+
+        activeTiles.clear();
+        binned.clear();
+
+        trianglesDrawn = 0;
+
+        std::replace(tileState.begin(), tileState.end(), uint8_t(TILE_DRAWN), uint8_t(TILE_STALE));
+    }
+}
+
+#include "mygl_simd.h"
 
 #endif /* _MY_GL_H_ */
\ No newline at end of file
@@ -0,0 +1,370 @@
+#ifndef _MY_GL_SIMD_H_
+#define _MY_GL_SIMD_H_
+
+/*
+    SSE4.1 and AVX2 triangle kernels for RendererBase3D
+
+    This file is included at the end of mygl.h. Unlike the linalg_simd.h kernels, these are picked at run time: each kernel
+    is compiled for its own instruction set with a target attribute, so a program built for plain x86-64 still gets the
+    AVX2 kernel on a CPU that has it. This needs GCC or Clang on x86; elsewhere, and with MYGL_NO_SIMD, the scalar kernel is
+    used. Set the environment variable MYGL_RASTER to scalar, sse4.1 or avx2 to force a kernel (if the CPU supports it).
+
+    The kernels step the edge functions for a run of pixels on a row at once (4 for SSE4.1, 8 for AVX2), skip runs that the
+    triangle does not cover, and depth test (unless the hierarchical z already decided) and store the covered pixels with
+    masks. z is computed per pixel exactly as in ScanTriangle. With a tiled framebuffer the runs start on a multiple of
+    their length, so that each one lies within a micro-tile. Every kernel is a template over the fragment policy, so a
+    policy's stores and Written hook are compiled into the loop.
+*/
+
+#include <cstdlib>
+#include <cstring>
+
+#if !defined(MYGL_NO_SIMD) && defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define MYGL_RASTER_DISPATCH
+#include <immintrin.h>
+#endif
+
+namespace mygl
+{
+namespace simd
+{
+    template<typename Fragments>
+    inline void RasterizeScalar(const TriangleSetup& s, uint32_t argb, uint32_t* pixels, float* zdepth, int width, bool depthTest, const Fragments& fragments)
+    {
+        ScanTriangle(s, [&](int x, int y, float depth)
+        {
+            int offset = PixelOffset(x, y, width);
+            bool passed = !depthTest || zdepth[offset] < depth;
+
+            if (depthTest) fragments.Tested(offset, 1, passed);
+
+            if (passed)
+            {
+                if (Fragments::DEPTH_WRITE) zdepth[offset] = depth;
+                if (Fragments::COLOUR_WRITE) pixels[offset] = argb;
+
+                fragments.Written(offset, 1, argb);
+            }
+        });
+    }
+
+#if defined(MYGL_RASTER_DISPATCH)
+    template<typename Fragments>
+    __attribute__((target("sse4.1")))
+    inline void RasterizeSSE41(const TriangleSetup& s, uint32_t argb, uint32_t* pixels, float* zdepth, int width, bool depthTest, const Fragments& fragments)
+    {
+        const __m128i lane = _mm_setr_epi32(0, 1, 2, 3);
+        const __m128i four = _mm_set1_epi32(4);
+        const __m128i outside = _mm_set1_epi32(-1);
+
+        const __m128i dx0 = _mm_set1_epi32(s.dx[0]);
+        const __m128i dx1 = _mm_set1_epi32(s.dx[1]);
+        const __m128i dx2 = _mm_set1_epi32(s.dx[2]);
+        const __m128i step0 = _mm_mullo_epi32(dx0, four);
+        const __m128i step1 = _mm_mullo_epi32(dx1, four);
+        const __m128i step2 = _mm_mullo_epi32(dx2, four);
+
+        const __m128 dzdx = _mm_set1_ps(s.dzdx);
+        const __m128 one = _mm_set1_ps(1.0f);
+        const __m128 colour = _mm_castsi128_ps(_mm_set1_epi32(argb));
+
+        int e0row = s.e[0] + (s.xmin - s.x0) * s.dx[0] + (s.ymin - s.y0) * s.dy[0];
+        int e1row = s.e[1] + (s.xmin - s.x0) * s.dx[1] + (s.ymin - s.y0) * s.dy[1];
+        int e2row = s.e[2] + (s.xmin - s.x0) * s.dx[2] + (s.ymin - s.y0) * s.dy[2];
+
+        for (int y = s.ymin; y <= s.ymax; ++y)
+        {
+            float zrow = s.z + (y - s.y0) * s.dzdy;
+
+            // a pixel that is not part of a run of 4
+            auto single = [&](int x)
+            {
+                int k = x - s.xmin;
+
+                if (((e0row + k * s.dx[0]) | (e1row + k * s.dx[1]) | (e2row + k * s.dx[2])) >= 0)
+                {
+                    float depth = 1.0f / (zrow + (x - s.x0) * s.dzdx);
+                    int offset = PixelOffset(x, y, width);
+                    bool passed = !depthTest || zdepth[offset] < depth;
+
+                    if (depthTest) fragments.Tested(offset, 1, passed);
+
+                    if (passed)
+                    {
+                        if (Fragments::DEPTH_WRITE) zdepth[offset] = depth;
+                        if (Fragments::COLOUR_WRITE) pixels[offset] = argb;
+
+                        fragments.Written(offset, 1, argb);
+                    }
+                }
+            };
+
+            int x = s.xmin;
+
+            // in a tiled framebuffer a run of 4 is only contiguous if it starts on a multiple of 4
+            if (TILED_FRAMEBUFFER)
+            {
+                for (; x <= s.xmax && (x & 3) != 0; ++x)
+                {
+                    single(x);
+                }
+            }
+
+            int k = x - s.xmin;
+
+            __m128 z0 = _mm_set1_ps(zrow);
+            __m128i e0 = _mm_add_epi32(_mm_set1_epi32(e0row + k * s.dx[0]), _mm_mullo_epi32(lane, dx0));
+            __m128i e1 = _mm_add_epi32(_mm_set1_epi32(e1row + k * s.dx[1]), _mm_mullo_epi32(lane, dx1));
+            __m128i e2 = _mm_add_epi32(_mm_set1_epi32(e2row + k * s.dx[2]), _mm_mullo_epi32(lane, dx2));
+            __m128i xoff = _mm_add_epi32(_mm_set1_epi32(x - s.x0), lane);
+
+            // whole runs of 4 only, so nothing outside of [xmin, xmax] is read or written
+            for (; x + 3 <= s.xmax; x += 4)
+            {
+                __m128 inside = _mm_castsi128_ps(_mm_cmpgt_epi32(_mm_or_si128(_mm_or_si128(e0, e1), e2), outside));
+
+                if (_mm_movemask_ps(inside))
+                {
+                    int offset = PixelOffset(x, y, width);
+
+                    __m128 z = _mm_add_ps(z0, _mm_mul_ps(_mm_cvtepi32_ps(xoff), dzdx));
+                    __m128 depth = _mm_div_ps(one, z);
+
+                    __m128 olddepth = _mm_loadu_ps(zdepth + offset);
+                    __m128 oldcolour = _mm_loadu_ps(reinterpret_cast<float*>(pixels + offset));
+                    __m128 pass = depthTest ? _mm_and_ps(inside, _mm_cmplt_ps(olddepth, depth)) : inside;
+
+                    if (Fragments::DEPTH_WRITE) _mm_storeu_ps(zdepth + offset, _mm_blendv_ps(olddepth, depth, pass));
+                    if (Fragments::COLOUR_WRITE) _mm_storeu_ps(reinterpret_cast<float*>(pixels + offset), _mm_blendv_ps(oldcolour, colour, pass));
+
+                    unsigned bits = _mm_movemask_ps(pass);
+
+                    if (depthTest) fragments.Tested(offset, _mm_movemask_ps(inside), bits);
+
+                    if (bits)
+                    {
+                        fragments.Written(offset, bits, argb);
+                    }
+                }
+
+                e0 = _mm_add_epi32(e0, step0);
+                e1 = _mm_add_epi32(e1, step1);
+                e2 = _mm_add_epi32(e2, step2);
+                xoff = _mm_add_epi32(xoff, four);
+            }
+
+            for (; x <= s.xmax; ++x)
+            {
+                single(x);
+            }
+
+            e0row += s.dy[0];
+            e1row += s.dy[1];
+            e2row += s.dy[2];
+        }
+    }
+
+    template<typename Fragments>
+    __attribute__((target("avx2")))
+    inline void RasterizeAVX2(const TriangleSetup& s, uint32_t argb, uint32_t* pixels, float* zdepth, int width, bool depthTest, const Fragments& fragments)
+    {
+        const __m256i lane = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+        const __m256i eight = _mm256_set1_epi32(8);
+        const __m256i outside = _mm256_set1_epi32(-1);
+
+        const __m256i dx0 = _mm256_set1_epi32(s.dx[0]);
+        const __m256i dx1 = _mm256_set1_epi32(s.dx[1]);
+        const __m256i dx2 = _mm256_set1_epi32(s.dx[2]);
+        const __m256i step0 = _mm256_mullo_epi32(dx0, eight);
+        const __m256i step1 = _mm256_mullo_epi32(dx1, eight);
+        const __m256i step2 = _mm256_mullo_epi32(dx2, eight);
+
+        const __m256 dzdx = _mm256_set1_ps(s.dzdx);
+        const __m256 one = _mm256_set1_ps(1.0f);
+        const __m256i colour = _mm256_set1_epi32(argb);
+
+        int e0row = s.e[0] + (s.xmin - s.x0) * s.dx[0] + (s.ymin - s.y0) * s.dy[0];
+        int e1row = s.e[1] + (s.xmin - s.x0) * s.dx[1] + (s.ymin - s.y0) * s.dy[1];
+        int e2row = s.e[2] + (s.xmin - s.x0) * s.dx[2] + (s.ymin - s.y0) * s.dy[2];
+
+        for (int y = s.ymin; y <= s.ymax; ++y)
+        {
+            float zrow = s.z + (y - s.y0) * s.dzdy;
+
+            // in a tiled framebuffer a run of 8 is only contiguous if it starts on a multiple of 8; the lanes before xmin
+            // are masked off like the ones after xmax
+            int xstart = TILED_FRAMEBUFFER ? s.xmin & ~7 : s.xmin;
+            int k = xstart - s.xmin;
+
+            __m256 z0 = _mm256_set1_ps(zrow);
+            __m256i e0 = _mm256_add_epi32(_mm256_set1_epi32(e0row + k * s.dx[0]), _mm256_mullo_epi32(lane, dx0));
+            __m256i e1 = _mm256_add_epi32(_mm256_set1_epi32(e1row + k * s.dx[1]), _mm256_mullo_epi32(lane, dx1));
+            __m256i e2 = _mm256_add_epi32(_mm256_set1_epi32(e2row + k * s.dx[2]), _mm256_mullo_epi32(lane, dx2));
+            __m256i xoff = _mm256_add_epi32(_mm256_set1_epi32(xstart - s.x0), lane);
+
+            for (int x = xstart; x <= s.xmax; x += 8)
+            {
+                // covered and not past the end of the row
+                __m256i inside = _mm256_cmpgt_epi32(_mm256_or_si256(_mm256_or_si256(e0, e1), e2), outside);
+                inside = _mm256_and_si256(inside, _mm256_cmpgt_epi32(_mm256_set1_epi32(s.xmax - x + 1), lane));
+
+                if (TILED_FRAMEBUFFER)
+                {
+                    inside = _mm256_and_si256(inside, _mm256_cmpgt_epi32(lane, _mm256_set1_epi32(s.xmin - x - 1)));
+                }
+
+                if (!_mm256_testz_si256(inside, inside))
+                {
+                    int offset = PixelOffset(x, y, width);
+
+                    __m256 z = _mm256_add_ps(z0, _mm256_mul_ps(_mm256_cvtepi32_ps(xoff), dzdx));
+                    __m256 depth = _mm256_div_ps(one, z);
+
+                    __m256i pass = inside;
+
+                    if (depthTest)
+                    {
+                        __m256 olddepth = _mm256_maskload_ps(zdepth + offset, inside);
+                        pass = _mm256_and_si256(inside, _mm256_castps_si256(_mm256_cmp_ps(olddepth, depth, _CMP_LT_OQ)));
+                    }
+
+                    if (Fragments::DEPTH_WRITE) _mm256_maskstore_ps(zdepth + offset, pass, depth);
+                    if (Fragments::COLOUR_WRITE) _mm256_maskstore_epi32(reinterpret_cast<int*>(pixels + offset), pass, colour);
+
+                    unsigned bits = _mm256_movemask_ps(_mm256_castsi256_ps(pass));
+
+                    if (depthTest) fragments.Tested(offset, _mm256_movemask_ps(_mm256_castsi256_ps(inside)), bits);
+
+                    if (bits)
+                    {
+                        fragments.Written(offset, bits, argb);
+                    }
+                }
+
+                e0 = _mm256_add_epi32(e0, step0);
+                e1 = _mm256_add_epi32(e1, step1);
+                e2 = _mm256_add_epi32(e2, step2);
+                xoff = _mm256_add_epi32(xoff, eight);
+            }
+
+            e0row += s.dy[0];
+            e1row += s.dy[1];
+            e2row += s.dy[2];
+        }
+    }
+#endif
+
+    enum class RasterLevel { SCALAR, SSE41, AVX2 };
+
+    struct RasterDispatch
+    {
+        RasterLevel level;
+        const char* name;
+    };
+
+    inline RasterDispatch SelectRasterKernel()
+    {
+#if defined(MYGL_RASTER_DISPATCH)
+        const char* force = std::getenv("MYGL_RASTER");
+
+        __builtin_cpu_init();
+
+        bool avx2 = __builtin_cpu_supports("avx2");
+        bool sse41 = __builtin_cpu_supports("sse4.1");
+
+        if (force != NULL && std::strcmp(force, "scalar") == 0) return {RasterLevel::SCALAR, "scalar"};
+        if (force != NULL && std::strcmp(force, "sse4.1") == 0) avx2 = false;
+
+        if (avx2) return {RasterLevel::AVX2, "AVX2"};
+        if (sse41) return {RasterLevel::SSE41, "SSE4.1"};
+#endif
+        return {RasterLevel::SCALAR, "scalar"};
+    }
+
+    inline const RasterDispatch& GetRasterDispatch()
+    {
+        static const RasterDispatch dispatch = SelectRasterKernel();
+        return dispatch;
+    }
+}
+
+    void FillBuffer(uint32_t* dst, uint32_t value, int n, bool stream)
+    {
+#if defined(MYGL_SSE2)
+        if (stream)
+        {
+            // non-temporal stores need 16 byte alignment
+            for (; n > 0 && (reinterpret_cast<uintptr_t>(dst) & 15) != 0; --n)
+            {
+                *dst++ = value;
+            }
+
+            const __m128i v = _mm_set1_epi32(int(value));
+
+            for (; n >= 4; n -= 4, dst += 4)
+            {
+                _mm_stream_si128(reinterpret_cast<__m128i*>(dst), v);
+            }
+        }
+#endif
+        std::fill(dst, dst + n, value);
+    }
+
+    void FillFence()
+    {
+#if defined(MYGL_SSE2)
+        _mm_sfence();
+#endif
+    }
+
+    // Every run of 8 pixels on a row of a micro-tile is in one piece and goes over as a whole
+    void ResolveTiles(const uint32_t* tiled, uint32_t* linear, int width, int height)
+    {
+        for (int y = 0; y < height; ++y)
+        {
+            uint32_t* row = linear + y * width;
+            int x = 0;
+
+            for (; x + 8 <= width; x += 8)
+            {
+                const uint32_t* src = tiled + PixelOffset(x, y, width);
+#if defined(MYGL_AVX)
+                _mm256_storeu_si256(reinterpret_cast<__m256i*>(row + x), _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src)));
+#elif defined(MYGL_SSE2)
+                _mm_storeu_si128(reinterpret_cast<__m128i*>(row + x), _mm_loadu_si128(reinterpret_cast<const __m128i*>(src)));
+                _mm_storeu_si128(reinterpret_cast<__m128i*>(row + x + 4), _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + 4)));
+#else
+                std::copy(src, src + 8, row + x);
+#endif
+            }
+
+            for (; x < width; ++x)
+            {
+                row[x] = tiled[PixelOffset(x, y, width)];
+            }
+        }
+    }
+
+    template<typename Fragments>
+    RasterKernel<Fragments> GetRasterKernel()
+    {
+        switch (simd::GetRasterDispatch().level)
+        {
+#if defined(MYGL_RASTER_DISPATCH)
+        case simd::RasterLevel::AVX2:
+            return simd::RasterizeAVX2<Fragments>;
+        case simd::RasterLevel::SSE41:
+            return simd::RasterizeSSE41<Fragments>;
+#endif
+        default:
+            return simd::RasterizeScalar<Fragments>;
+        }
+    }
+
+    const char* GetRasterKernelName()
+    {
+        return simd::GetRasterDispatch().name;
+    }
+}
+
+#endif /* _MY_GL_SIMD_H_ */
@@ -1,18 +1,17 @@
-/* g++ poggers.cpp -o poggers -std=c++14 -lSDL2 */
+/* g++ poggers.cpp -o poggers -std=c++14 -pthread -lSDL2 */
 /*
 TODO
 - shaders
 - camera
 - amp.h to exploit gpu
 - gif encoder
-- mysterious division by zero
 */
 
 #include <SDL2/SDL.h>
 
-#include "mygl.h"
+#include "poggers.h"
 
-// these header files must be placed after mygl.h for technical reasons
+// these header files must be placed after mygl.h (included by poggers.h) for technical reasons
 #include <Windows.h>
 #include <Windowsx.h>
 
@@ -21,121 +20,35 @@ TODO
 
 #define ID_TIMER 1
 
-using namespace mygl;
+using namespace poggers;
 
 const int SCREEN_WIDTH = 600;
 const int SCREEN_HEIGHT = 600;
 const int SCREEN_SCALE_FACTOR = 1;
 
-/*
-Cube
-
-    +6-------+5
-   /         /|
- +7--------+8 |
-  |         | |
-  | +1      |+4
-  |         |/
- +2--------+3
-
-*/
-
-const Model cube = {
-    8,
-    12,
-    {
-        vec4f(-50.0f, -50.0f, -50.0f, 1.0f), // 1
-        vec4f(-50.0f, -50.0f, 50.0f, 1.0f),  // 2
-        vec4f(50.0f, -50.0f, 50.0f, 1.0f),   // 3
-        vec4f(50.0f, -50.0f, -50.0f, 1.0f),  // 4
-        vec4f(50.0f, 50.0f, -50.0f, 1.0f),   // 5
-        vec4f(-50.0f, 50.0f, -50.0f, 1.0f),  // 6
-        vec4f(-50.0f, 50.0f, 50.0f, 1.0f),   // 7
-        vec4f(50.0f, 50.0f, 50.0f, 1.0f),    // 8
-    },
-    {
-        // Face 1-2-6-7
-        {true, RED, {0, 6, 1}},   // 1-7-2
-        {true, RED, {0, 5, 6}},   // 1-6-7
-
-        // Face 2-3-7-8
-        {true, YELLOW, {1, 7, 2}}, // 2-8-3
-        {true, YELLOW, {1, 6, 7}}, // 2-7-8
-
-        // Face 3-4-8-5
-        {true, INDIGO, {2, 4, 3}}, // 3-5-4
-        {true, INDIGO, {2, 7, 4}}, // 3-8-5
-
-        // Face 4-1-5-6
-        {true, GREEN, {0, 3, 4}}, // 1-4-5
-        {true, GREEN, {0, 4, 5}}, // 1-5-6
-
-        // Face 1-2-3-4
-        {true, BLUE, {0, 1, 2}},  // 1-2-3
-        {true, BLUE, {0, 2, 3}},  // 1-3-4
-
-        // Face 5-6-7-8
-        {true, ORANGE, {4, 6, 5}}, // 5-7-6
-        {true, ORANGE, {4, 7, 6}}, // 5-8-7
-    }
-};
-
-const vec3f xaxis = {1, 0, 0};
-const vec3f yaxis = {0, 1, 0};
-const vec3f zaxis = {0, 0, 1};
-
-class Poggers : public RendererBase3D
+// Shows the scene in a window, through SDL
+class PoggersWindow : public Poggers
 {
 public:
-    Poggers(int width, int height);
-    ~Poggers();
+    PoggersWindow(int width, int height);
 
     void Create(HWND hwnd, int updateInterval);
     void Show();
     void CleanUp();
     void Destroy();
-
-    void Init();
-    void Update();
-    void Render();
-
-    void HandleMousePress(int mouseX, int mouseY);
-    void HandleMouseRelease(int mouseX, int mouseY);
-    void HandleMouseMotion(int mouseX, int mouseY);
 private:
     HWND hwnd;
 
     SDL_Window* wnd;
     SDL_Renderer* renderer;
     SDL_Texture* texture;
-
-    float angle; // for continuous counterclockwise rotation about y-axis
-    const float dAngle = 0.02f;
-
-    vec3f light; // direction of light source (from model's pov)
-
-    vec3f p, q;
-
-    Quaternion<float> currentQ, lastQ;
-    Quaternion<float> rotatey;
-
-    mat4f trans, modelm, projm;
-    mat4f vpTransf;
-
-    float xscale;
-    float yscale;
-
-    vec3f ProjectToSphere(int mx, int my);
 };
 
-Poggers::Poggers(int width, int height)
-  : RendererBase3D(width, height)
+PoggersWindow::PoggersWindow(int width, int height)
+  : Poggers(width, height)
 {}
 
-Poggers::~Poggers()
-{}
-
-void Poggers::Create(HWND hWnd, int updateInterval)
+void PoggersWindow::Create(HWND hWnd, int updateInterval)
 {
     if (SDL_Init(SDL_INIT_EVERYTHING) < 0)
     {
@@ -175,17 +88,17 @@ void Poggers::Create(HWND hWnd, int updateInterval)
     Init();
 }
 
-void Poggers::Show()
+void PoggersWindow::Show()
 {
     ClearScreen();
     Render();
 
-    SDL_UpdateTexture(texture, NULL, &pixels[0], width * 4);
+    SDL_UpdateTexture(texture, NULL, Present(), width * 4);
     SDL_RenderCopy(renderer, texture, NULL, NULL);
     SDL_RenderPresent(renderer);
 }
 
-void Poggers::CleanUp()
+void PoggersWindow::CleanUp()
 {
     SDL_DestroyTexture(texture);
     texture = NULL;
@@ -200,159 +113,14 @@ void Poggers::CleanUp()
     KillTimer(hwnd, ID_TIMER);
 }
 
-void Poggers::Destroy()
+void PoggersWindow::Destroy()
 {
     PostQuitMessage(0);
 }
 
-void Poggers::Init()
-{
-    light = vec3f(0.0f, 0.0f, 50.0f).Unit(); // (in world coordinates) light comes out behind the screen (normalized)
-
-    angle = 0.0f;
-    rotatey = Quaternion<float>(true);
-
-    currentQ = Quaternion<float>(true);
-    lastQ = Quaternion<float>(zaxis, M_PI / 4.0f); // the cube is initially rotated 45 degree counterclockwise about z-axis
-
-    mat4f rot = CreateRotationMatrix4<float>(lastQ);
-
-    trans = CreateTranslationMatrix4<float>(0.0f, 0.0f, -100.0f);
-    modelm = trans * rot;
-    projm = CreateOrthographic4<float>(-120.0f, 120.0f, -120.0f, 120.0f, 0.0f, 200.0f); // CreateViewingFrustum4<float>(-0.2f, 0.2f, -0.2f, 0.2f, 0.1f, 140.0f);
-
-    // for viewport transform
-    mat4f vpScale = CreateScalingMatrix4<float>(width / 2.0f, -height / 2.0f, width / 2.0f); // the minus sign is used to flip y axis; assume that the depth of z is width
-    mat4f vpTranslate = CreateTranslationMatrix4<float>(width / 2.0f, height / 2.0f, width / 2.0f + 0.5f); // +0.5 to make sure that z > 0
-
-    vpTransf = vpTranslate * vpScale;
-
-    xscale = 2.0f / (width - 1.0f);
-    yscale = 2.0f / (height - 1.0f);
-}
-
-void Poggers::Update()
-{/*
-    angle += dAngle;
-
-    rotatey = Quaternion<float>(yaxis, angle);
-    mat4f rot = CreateRotationMatrix4<float>(currentQ * lastQ * rotatey);
-
-    modelm = trans * rot;*/
-}
-
-void Poggers::Render()
-{
-    int trigs = cube.ntrig;
-
-    //debug
-    //int drawn = 0;
-
-    for (int i = 0; i < trigs; ++i)
-    {
-        Triangle t = cube.triangle[i];
-
-        vec4f v1 = modelm * cube.vertex[t.vertex[0]];
-        vec4f v2 = modelm * cube.vertex[t.vertex[1]];
-        vec4f v3 = modelm * cube.vertex[t.vertex[2]];
-
-        vec3f vert1 = v1.Demote();
-        vec3f vert2 = v2.Demote();
-        vec3f vert3 = v3.Demote();
-
-        // vector normal to surface
-        vec3f n = CrossProduct(vert3 - vert1, vert2 - vert1).Unit();
-
-        // luminance
-        float L = n * light;
-
-        //debug
-        //std::cerr << "Triangle #" << i << ": n=" << n << ", light=" << light << ", Luminance=" << L << std::endl;
-
-        // L <= 0 means the triangle is hidden from the view
-        if (L > 0.0f)
-        {
-            v1 = projm * v1;
-            v2 = projm * v2;
-            v3 = projm * v3;
-
-            // perspective division
-            v1 /= v1[3];
-            v2 /= v2[3];
-            v3 /= v3[3];
-
-            v1 = vpTransf * v1;
-            v2 = vpTransf * v2;
-            v3 = vpTransf * v3;
-
-            if (t.filled)
-            {
-                DrawFilledTriangleBarycentric(v1.Demote(), v2.Demote(), v3.Demote(), t.colour.AdjustBrightness(L));
-            }
-            else
-            {
-                DrawWireframeTriangleDDA(v1.Demote(), v2.Demote(), v3.Demote(), t.colour);
-            }
-
-            //debug
-            //drawn++;
-        }
-    }
-
-    //debug
-    //std::cerr << "Number of triangles drawn: " << drawn << std::endl;
-}
-
-void Poggers::HandleMousePress(int mouseX, int mouseY)
-{
-    p = ProjectToSphere(mouseX, mouseY);
-}
-
-void Poggers::HandleMouseRelease(int mouseX, int mouseY)
-{
-    lastQ = currentQ * lastQ;
-    currentQ = Quaternion<float>(true);
-}
-
-void Poggers::HandleMouseMotion(int mouseX, int mouseY)
-{
-    q = ProjectToSphere(mouseX, mouseY);
-
-    vec3f n = CrossProduct(p, q);
-    float theta = std::acos((p * q) / (p.Magnitude() * q.Magnitude()));
-
-    currentQ = Quaternion<float>(n, theta);
-
-    mat4f rot = CreateRotationMatrix4<float>(currentQ * lastQ * rotatey);
-    modelm = trans * rot;
-}
-
-vec3f Poggers::ProjectToSphere(int mx, int my)
-{
-    const float r = 1.0f;
-
-    /* x and y are mapped to [-1, 1] */
-    float x = (mx * xscale) - 1.0f;
-    float y = 1.0f - (my * yscale);
-    float z;
-
-    float length2 = x * x + y * y;
-
-    if (length2 <= r * r / 2.0f) // inside the sphere
-    {
-        z = std::sqrt(r * r - length2);
-    }
-    else
-    {
-        z = (r * r / 2.0f) / std::sqrt(length2);
-    }
-
-    return vec3f(x, y, z);
-}
-
 LRESULT CALLBACK WndProc(HWND hWnd, UINT msg, WPARAM wParam, LPARAM lParam)
 {
-    static Poggers app(SCREEN_WIDTH, SCREEN_HEIGHT);
+    static PoggersWindow app(SCREEN_WIDTH, SCREEN_HEIGHT);
     static bool bMousePressed = false;
     int mouseX, mouseY;
 
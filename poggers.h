@@ -0,0 +1,203 @@
+#ifndef _POGGERS_H_
+#define _POGGERS_H_
+
+/*
+    The Poggers scene: a cube that is turned around with the mouse (an arcball). It only needs a RendererBase3D, so it can
+    be shown in a window (poggers.cpp) or rendered without one (headless.cpp).
+*/
+
+#include <cmath>
+
+#include "mygl.h"
+
+namespace poggers
+{
+    using namespace mygl;
+
+    /*
+    Cube
+
+        +6-------+5
+       /         /|
+     +7--------+8 |
+      |         | |
+      | +1      |+4
+      |         |/
+     +2--------+3
+
+    */
+
+    const Model cube = {
+        8,
+        12,
+        {
+            vec4f(-50.0f, -50.0f, -50.0f, 1.0f), // 1
+            vec4f(-50.0f, -50.0f, 50.0f, 1.0f),  // 2
+            vec4f(50.0f, -50.0f, 50.0f, 1.0f),   // 3
+            vec4f(50.0f, -50.0f, -50.0f, 1.0f),  // 4
+            vec4f(50.0f, 50.0f, -50.0f, 1.0f),   // 5
+            vec4f(-50.0f, 50.0f, -50.0f, 1.0f),  // 6
+            vec4f(-50.0f, 50.0f, 50.0f, 1.0f),   // 7
+            vec4f(50.0f, 50.0f, 50.0f, 1.0f),    // 8
+        },
+        {
+            // Face 1-2-6-7
+            {true, RED, {0, 6, 1}},   // 1-7-2
+            {true, RED, {0, 5, 6}},   // 1-6-7
+
+            // Face 2-3-7-8
+            {true, YELLOW, {1, 7, 2}}, // 2-8-3
+            {true, YELLOW, {1, 6, 7}}, // 2-7-8
+
+            // Face 3-4-8-5
+            {true, INDIGO, {2, 4, 3}}, // 3-5-4
+            {true, INDIGO, {2, 7, 4}}, // 3-8-5
+
+            // Face 4-1-5-6
+            {true, GREEN, {0, 3, 4}}, // 1-4-5
+            {true, GREEN, {0, 4, 5}}, // 1-5-6
+
+            // Face 1-2-3-4
+            {true, BLUE, {0, 1, 2}},  // 1-2-3
+            {true, BLUE, {0, 2, 3}},  // 1-3-4
+
+            // Face 5-6-7-8
+            {true, ORANGE, {4, 6, 5}}, // 5-7-6
+            {true, ORANGE, {4, 7, 6}}, // 5-8-7
+        }
+    };
+
+    constexpr vec3f xaxis = {1, 0, 0};
+    constexpr vec3f yaxis = {0, 1, 0};
+    constexpr vec3f zaxis = {0, 0, 1};
+
+    // The projection never changes, so it is computed at compile time
+    constexpr mat4f PROJECTION = CreateOrthographic4<float>(-120.0f, 120.0f, -120.0f, 120.0f, 0.0f, 200.0f); // CreateViewingFrustum4<float>(-0.2f, 0.2f, -0.2f, 0.2f, 0.1f, 140.0f);
+
+    class Poggers : public RendererBase3D
+    {
+    public:
+        Poggers(int width, int height);
+        ~Poggers();
+
+        void Init();
+        void Update();
+        void Render();
+
+        void HandleMousePress(int mouseX, int mouseY);
+        void HandleMouseRelease(int mouseX, int mouseY);
+        void HandleMouseMotion(int mouseX, int mouseY);
+    private:
+        float angle; // for continuous counterclockwise rotation about y-axis
+        const float dAngle = 0.02f;
+
+        vec3f light; // direction of light source (from model's pov)
+
+        vec3f p, q;
+
+        Quaternion<float> currentQ, lastQ;
+        Quaternion<float> rotatey;
+
+        affine3f trans, modelm;
+        mat4f projm;
+
+        float xscale;
+        float yscale;
+
+        vec3f ProjectToSphere(int mx, int my);
+    };
+
+    Poggers::Poggers(int width, int height)
+      : RendererBase3D(width, height)
+    {}
+
+    Poggers::~Poggers()
+    {}
+
+    void Poggers::Init()
+    {
+        light = vec3f(0.0f, 0.0f, 50.0f).Unit(); // (in world coordinates) light comes out behind the screen (normalized)
+
+        angle = 0.0f;
+        rotatey = Quaternion<float>(true);
+
+        currentQ = Quaternion<float>(true);
+        lastQ = Quaternion<float>(zaxis, M_PI / 4.0f); // the cube is initially rotated 45 degree counterclockwise about z-axis
+
+        affine3f rot(CreateRotationMatrix3<float>(lastQ));
+
+        trans = affine3f(CreateTranslationMatrix4<float>(0.0f, 0.0f, -100.0f));
+        modelm = trans * rot;
+        projm = PROJECTION; // viewport is left as it is, the whole screen
+
+        xscale = 2.0f / (width - 1.0f);
+        yscale = 2.0f / (height - 1.0f);
+    }
+
+    void Poggers::Update()
+    {/*
+        angle += dAngle;
+
+        rotatey = Quaternion<float>(yaxis, angle);
+        affine3f rot(CreateRotationMatrix3<float>(currentQ * lastQ * rotatey));
+
+        modelm = trans * rot;*/
+    }
+
+    void Poggers::Render()
+    {
+        MYGL_PROFILE_ZONE("Poggers::Render");
+
+        // transforms, culling, lighting, clipping and perspective division are all done by the renderer
+        DrawModel(cube, modelm, projm, light);
+    }
+
+    void Poggers::HandleMousePress(int mouseX, int mouseY)
+    {
+        p = ProjectToSphere(mouseX, mouseY);
+    }
+
+    void Poggers::HandleMouseRelease(int mouseX, int mouseY)
+    {
+        lastQ = currentQ * lastQ;
+        currentQ = Quaternion<float>(true);
+    }
+
+    void Poggers::HandleMouseMotion(int mouseX, int mouseY)
+    {
+        q = ProjectToSphere(mouseX, mouseY);
+
+        vec3f n = CrossProduct(p, q);
+        float theta = std::acos((p * q) / (p.Magnitude() * q.Magnitude()));
+
+        currentQ = Quaternion<float>(n, theta);
+
+        affine3f rot(CreateRotationMatrix3<float>(currentQ * lastQ * rotatey));
+        modelm = trans * rot;
+    }
+
+    vec3f Poggers::ProjectToSphere(int mx, int my)
+    {
+        const float r = 1.0f;
+
+        /* x and y are mapped to [-1, 1] */
+        float x = (mx * xscale) - 1.0f;
+        float y = 1.0f - (my * yscale);
+        float z;
+
+        float length2 = x * x + y * y;
+
+        if (length2 <= r * r / 2.0f) // inside the sphere
+        {
+            z = std::sqrt(r * r - length2);
+        }
+        else
+        {
+            z = (r * r / 2.0f) / std::sqrt(length2);
+        }
+
+        return vec3f(x, y, z);
+    }
+}
+
+#endif /* _POGGERS_H_ */
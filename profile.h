@@ -0,0 +1,246 @@
+#ifndef _PROFILE_H_
+#define _PROFILE_H_
+
+/*
+    Scoped timing zones
+
+    MYGL_PROFILE_ZONE("name") at the top of a scope times the scope; MYGL_PROFILE_THREAD("name") names the calling thread
+    in the trace. Without MYGL_PROFILE defined both expand to nothing, so the zones in linalg.h, mygl.h and the scenes cost
+    nothing in a normal build. The name must outlive the trace, a string literal in practice.
+
+    Every thread records into a ring buffer of its own, so recording takes no lock: the thread writes the event and then
+    publishes it with a release store of its count, and once PROFILE_EVENTS events are recorded the oldest are overwritten.
+    The buffers are registered when a thread records its first zone and are kept after the thread ends, so that a trace
+    taken later still shows it.
+
+    WriteChromeTrace writes what the buffers hold in the Chrome trace event format, which chrome://tracing, Perfetto and
+    speedscope open, one row per thread. It can run while other threads are recording, the events they overwrite in the
+    meantime are left out, but a zone only shows up once it has ended, so the natural place for it is between frames.
+*/
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#if defined(MYGL_PROFILE)
+#define MYGL_PROFILE_CONCAT_(a, b) a##b
+#define MYGL_PROFILE_CONCAT(a, b) MYGL_PROFILE_CONCAT_(a, b)
+#define MYGL_PROFILE_ZONE(name) ::mygl::profile::Zone MYGL_PROFILE_CONCAT(profileZone, __LINE__)(name)
+#define MYGL_PROFILE_THREAD(name) ::mygl::profile::NameThread(name)
+#else
+#define MYGL_PROFILE_ZONE(name) ((void)0)
+#define MYGL_PROFILE_THREAD(name) ((void)0)
+#endif
+
+namespace mygl
+{
+#if defined(MYGL_PROFILE)
+    const bool PROFILE = true;
+#else
+    const bool PROFILE = false;
+#endif
+
+namespace profile
+{
+    const int PROFILE_EVENTS = 1 << 16; // per thread, a power of 2
+
+    struct Event
+    {
+        const char* name;
+        int64_t start; // in nanoseconds since Now() was first called
+        int64_t end;
+    };
+
+    struct ThreadBuffer
+    {
+        int id;
+        std::string name;
+        std::atomic<uint64_t> count{0}; // events ever recorded, only the owning thread writes it
+        Event events[PROFILE_EVENTS];
+    };
+
+    struct Registry
+    {
+        std::mutex m; // for threads and the names
+        std::vector<std::unique_ptr<ThreadBuffer>> threads;
+    };
+
+    inline Registry& GetRegistry()
+    {
+        static Registry registry;
+        return registry;
+    }
+
+    inline int64_t Now()
+    {
+        static const std::chrono::steady_clock::time_point epoch = std::chrono::steady_clock::now();
+
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - epoch).count();
+    }
+
+    inline ThreadBuffer* RegisterThread()
+    {
+        Registry& registry = GetRegistry();
+        std::lock_guard<std::mutex> lock(registry.m);
+
+        std::unique_ptr<ThreadBuffer> buffer(new ThreadBuffer);
+
+        buffer->id = int(registry.threads.size()) + 1;
+        buffer->name = "thread " + std::to_string(buffer->id);
+        registry.threads.push_back(std::move(buffer));
+
+        return registry.threads.back().get();
+    }
+
+    // The calling thread's buffer
+    inline ThreadBuffer& GetThreadBuffer()
+    {
+        thread_local ThreadBuffer* buffer = RegisterThread();
+        return *buffer;
+    }
+
+    inline void Record(const char* name, int64_t start, int64_t end)
+    {
+        ThreadBuffer& buffer = GetThreadBuffer();
+        uint64_t n = buffer.count.load(std::memory_order_relaxed);
+
+        buffer.events[n & (PROFILE_EVENTS - 1)] = {name, start, end};
+        buffer.count.store(n + 1, std::memory_order_release);
+    }
+
+    inline void NameThread(const char* name)
+    {
+        ThreadBuffer& buffer = GetThreadBuffer();
+        std::lock_guard<std::mutex> lock(GetRegistry().m);
+
+        buffer.name = name;
+    }
+
+    class Zone
+    {
+    public:
+        explicit Zone(const char* name) : name(name), start(Now()) {}
+        ~Zone() { Record(name, start, Now()); }
+
+        Zone(const Zone&) = delete;
+        Zone& operator=(const Zone&) = delete;
+    private:
+        const char* name;
+        int64_t start;
+    };
+
+    inline void WriteJsonString(std::ostream& out, const char* s)
+    {
+        out << '"';
+
+        for (; *s; ++s)
+        {
+            unsigned char c = *s;
+
+            if (c == '"' || c == '\\')
+            {
+                out << '\\' << char(c);
+            }
+            else if (c < 0x20)
+            {
+                char escaped[8];
+                std::snprintf(escaped, sizeof(escaped), "\\u%04x", c);
+                out << escaped;
+            }
+            else
+            {
+                out << char(c);
+            }
+        }
+
+        out << '"';
+    }
+
+    inline void WriteMicroseconds(std::ostream& out, int64_t ns)
+    {
+        char us[32];
+        std::snprintf(us, sizeof(us), "%lld.%03d", (long long)(ns / 1000), int(ns % 1000));
+        out << us;
+    }
+}
+
+    // Writes every thread's recorded zones as a Chrome trace, see profile.h. Without MYGL_PROFILE the trace is empty
+    inline void WriteChromeTrace(std::ostream& out)
+    {
+        profile::Registry& registry = profile::GetRegistry();
+        std::lock_guard<std::mutex> lock(registry.m);
+
+        bool first = true;
+
+        auto separate = [&]()
+        {
+            out << (first ? "\n" : ",\n");
+            first = false;
+        };
+
+        out << "{\"traceEvents\":[";
+
+        for (const std::unique_ptr<profile::ThreadBuffer>& thread : registry.threads)
+        {
+            separate();
+            out << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << thread->id << ",\"args\":{\"name\":";
+            profile::WriteJsonString(out, thread->name.c_str());
+            out << "}}";
+
+            uint64_t end = thread->count.load(std::memory_order_acquire);
+            uint64_t begin = end > uint64_t(profile::PROFILE_EVENTS) ? end - profile::PROFILE_EVENTS : 0;
+
+            std::vector<profile::Event> events;
+
+            for (uint64_t i = begin; i < end; ++i)
+            {
+                events.push_back(thread->events[i & (profile::PROFILE_EVENTS - 1)]);
+            }
+
+            // the ones the thread may have overwritten while they were copied
+            uint64_t now = thread->count.load(std::memory_order_acquire);
+            uint64_t skip = now > begin + profile::PROFILE_EVENTS ? std::min(now - begin - profile::PROFILE_EVENTS, end - begin) : 0;
+
+            for (size_t i = size_t(skip); i < events.size(); ++i)
+            {
+                const profile::Event& e = events[i];
+
+                separate();
+                out << "{\"name\":";
+                profile::WriteJsonString(out, e.name);
+                out << ",\"ph\":\"X\",\"pid\":1,\"tid\":" << thread->id << ",\"ts\":";
+                profile::WriteMicroseconds(out, e.start);
+                out << ",\"dur\":";
+                profile::WriteMicroseconds(out, e.end - e.start);
+                out << "}";
+            }
+        }
+
+        out << "\n],\"displayTimeUnit\":\"ms\"}\n";
+    }
+
+    // False if the file could not be written
+    inline bool WriteChromeTrace(const char* path)
+    {
+        std::ofstream out(path);
+
+        if (!out)
+        {
+            return false;
+        }
+
+        WriteChromeTrace(out);
+
+        return bool(out);
+    }
+}
+
+#endif /* _PROFILE_H_ */
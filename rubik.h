@@ -0,0 +1,727 @@
+#ifndef _RUBIK_H_
+#define _RUBIK_H_
+
+/*
+    The Rubik scene: a 2x2 Rubik's cube that is turned around with the left mouse button, has its layers turned by dragging
+    them with the right one and can be scrambled. It only needs a RendererBase3D, so it can be shown in a window (rubik.cpp)
+    or rendered without one (headless.cpp).
+*/
+
+#include <array>
+#include <algorithm>
+
+#include <cstdlib>
+#include <ctime>
+
+//debug
+#include <iostream>
+
+#include "mygl.h"
+
+namespace rubik
+{
+    using namespace mygl;
+
+    struct Cubie
+    {
+        Colour col[6]; // colour for each of the 6 faces
+        affine3f position; // represents cube's position in 3D space (points to its center; encodes both translations and rotations)
+    };
+
+    /*
+    Cube
+        +6-------+5
+       /         /|
+     +7--------+8 |
+      |         | |
+      | +1      |+4
+      |         |/
+     +2--------+3
+    */
+
+    const Model cube = {
+        8,
+        12,
+        {
+            vec4f(-18.0f, -18.0f, -18.0f, 1.0f), // 1
+            vec4f(-18.0f, -18.0f, 18.0f, 1.0f),  // 2
+            vec4f(18.0f, -18.0f, 18.0f, 1.0f),   // 3
+            vec4f(18.0f, -18.0f, -18.0f, 1.0f),  // 4
+            vec4f(18.0f, 18.0f, -18.0f, 1.0f),   // 5
+            vec4f(-18.0f, 18.0f, -18.0f, 1.0f),  // 6
+            vec4f(-18.0f, 18.0f, 18.0f, 1.0f),   // 7
+            vec4f(18.0f, 18.0f, 18.0f, 1.0f),    // 8
+        },
+        {
+            // Face 1-2-6-7
+            {true, Colour(), {0, 6, 1}}, // 1-7-2
+            {true, Colour(), {0, 5, 6}}, // 1-6-7
+
+            // Face 2-3-7-8
+            {true, Colour(), {1, 7, 2}}, // 2-8-3
+            {true, Colour(), {1, 6, 7}}, // 2-7-8
+
+            // Face 3-4-8-5
+            {true, Colour(), {2, 4, 3}}, // 3-5-4
+            {true, Colour(), {2, 7, 4}}, // 3-8-5
+
+            // Face 4-1-5-6
+            {true, Colour(), {0, 3, 4}}, // 1-4-5
+            {true, Colour(), {0, 4, 5}}, // 1-5-6
+
+            // Face 1-2-3-4
+            {true, Colour(), {0, 1, 2}}, // 1-2-3
+            {true, Colour(), {0, 2, 3}}, // 1-3-4
+
+            // Face 5-6-7-8
+            {true, Colour(), {4, 6, 5}}, // 5-7-6
+            {true, Colour(), {4, 7, 6}}, // 5-8-7
+        }
+    };
+
+    const Colour RUBIK_GREEN(0, 155, 72, 255);
+
+    constexpr vec3f xaxis = {1, 0, 0};
+    constexpr vec3f yaxis = {0, 1, 0};
+    constexpr vec3f zaxis = {0, 0, 1};
+
+    // The projection never changes, so it is computed at compile time
+    constexpr mat4f PROJECTION = CreateOrthographic4<float>(-120.0f, 120.0f, -120.0f, 120.0f, 0.0f, 200.0f); // CreateViewingFrustum4<float>(-0.2f, 0.2f, -0.2f, 0.2f, 0.1f, 140.0f);
+
+    /*
+    Cubie array indexes for 2x2 cube
+        +0-------+1
+       /         /|
+     +2--------+3 |
+      |         | |
+      | +4      |+5
+      |         |/
+     +6--------+7
+    */
+
+    const int rotation_group[6][4] = {
+        /* top and bottom layers */
+        {0, 1, 2, 3}, // 0
+        {4, 5, 6, 7}, // 1
+
+        /* front and back layers */
+        {2, 3, 6, 7}, // 2
+        {0, 1, 4, 5}, // 3
+
+        /* left and right layers */
+        {0, 2, 4, 6}, // 4
+        {1, 3, 5, 7}, // 5
+    };
+
+    /* an index in cubie array corresponds to which rotation group? */
+    const int group_index[3][8] = {
+        // +x/-x axis
+        {4, 5, 4, 5, 4, 5, 4, 5},
+
+        // +y/-y axis
+        {0, 0, 0, 0, 1, 1, 1, 1},
+
+        // +z/-z axis
+        {3, 3, 2, 2, 3, 3, 2, 2},
+    };
+
+    /* normal vector directions */
+    enum {
+        X_AXIS=0,
+        N_X_AXIS,
+        Y_AXIS,
+        N_Y_AXIS,
+        Z_AXIS,
+        N_Z_AXIS
+    };
+
+    // Fragment policy that also records in the mask which cubie and face each pixel shows
+    struct WriteMask : DepthColourWrite
+    {
+        uint8_t* mask;
+        uint8_t id;
+
+        WriteMask(uint8_t* mask, uint8_t id) : mask(mask), id(id) {}
+
+        void Written(int offset, unsigned bits, uint32_t) const
+        {
+            for (int i = 0; bits != 0; ++i, bits >>= 1)
+            {
+                if (bits & 1) mask[offset + i] = id;
+            }
+        }
+    };
+
+    class Rubik : public RendererBase3D
+    {
+    public:
+        Rubik(int width, int height);
+        ~Rubik();
+
+        void Init();
+        void Render();
+        void Update();
+
+        void StartScramble();
+
+        void HandleMousePress(int mouseX, int mouseY);
+        void HandleMouseRelease(int mouseX, int mouseY);
+        void HandleMouseMotion(int mouseX, int mouseY);
+
+        void HandleRightMouseButtonPress(int mouseX, int mouseY);
+        void HandleRightMouseButtonRelease(int mouseX, int mouseY);
+        void HandleMouseMotionR(int mouseX, int mouseY);
+    protected:
+        // A move is animated by calling Update regularly from StartAnimation until StopAnimation, eg. on a timer
+        virtual void StartAnimation() {}
+        virtual void StopAnimation() {}
+    private:
+        Cubie rubik_cube[8];
+
+        int flagged_index;
+        int flagged_face;
+        bool on_cube;
+
+        // position on screen corresponds to which cubie and which face?
+        // each element is 8 bit unsigned where higher nibble represents face number and lower nibble represents cube index (for cubie array)
+        std::vector<uint8_t> mask; // laid out like pixels, see PixelOffset
+
+        //debug
+        vec4f normal, origin;
+
+        vec3f light; // direction of light source (from model's pov)
+
+        bool rotating;
+        bool mouselock;
+        float angle;
+        float da;
+        vec3f axis;
+        int which; // 0-left/right; 1-top/bottom; 2-front/back
+        int group;
+        int orien;
+
+        bool scrambling;
+        bool noaxis;
+        int ntimes;
+
+        vec3f p, q;
+        Quaternion<float> currentQ, lastQ;
+
+        affine3f trans, modelm;
+        mat4f projm;
+
+        affine3f modelmi;
+        mat4f trans_projmi;
+        // to unproject screen coordinates (x, y, depth), use unprojm*vec4f(x, y, 1/depth, 1.0f)
+        // warning: it might not work if perspective projection is used...
+        mat4f unprojm;
+
+        float xscale;
+        float yscale;
+
+        vec3f ProjectToSphere(int mouseX, int mouseY);
+        vec3f Unproject(int mouseX, int mouseY);
+
+        void RotateSwap(int group, int orien);
+    };
+
+    Rubik::Rubik(int width, int height)
+      : RendererBase3D(width, height), mask(FramebufferSize(width, height))
+    {
+        std::fill(mask.begin(), mask.end(), -1); // -1 means index not specified
+    }
+
+    Rubik::~Rubik()
+    {}
+
+    void Rubik::Init()
+    {
+        /* top layer */
+
+        /* list of cubies starting from top left to bottom right cubie */
+        rubik_cube[0].col[0] = RED;
+        rubik_cube[0].col[1] = BLACK;
+        rubik_cube[0].col[2] = BLACK;
+        rubik_cube[0].col[3] = RUBIK_GREEN;
+        rubik_cube[0].col[4] = BLACK;
+        rubik_cube[0].col[5] = WHITE;
+        rubik_cube[0].position = affine3f(CreateTranslationMatrix4<float>(-20.0f, 20.0f, -20.0f));
+
+        rubik_cube[1].col[0] = BLACK;
+        rubik_cube[1].col[1] = BLACK;
+        rubik_cube[1].col[2] = ORANGE;
+        rubik_cube[1].col[3] = RUBIK_GREEN;
+        rubik_cube[1].col[4] = BLACK;
+        rubik_cube[1].col[5] = WHITE;
+        rubik_cube[1].position = affine3f(CreateTranslationMatrix4<float>(20.0f, 20.0f, -20.0f));
+
+        rubik_cube[2].col[0] = RED;
+        rubik_cube[2].col[1] = BLUE;
+        rubik_cube[2].col[2] = BLACK;
+        rubik_cube[2].col[3] = BLACK;
+        rubik_cube[2].col[4] = BLACK;
+        rubik_cube[2].col[5] = WHITE;
+        rubik_cube[2].position = affine3f(CreateTranslationMatrix4<float>(-20.0f, 20.0f, 20.0f));
+
+        rubik_cube[3].col[0] = BLACK;
+        rubik_cube[3].col[1] = BLUE;
+        rubik_cube[3].col[2] = ORANGE;
+        rubik_cube[3].col[3] = BLACK;
+        rubik_cube[3].col[4] = BLACK;
+        rubik_cube[3].col[5] = WHITE;
+        rubik_cube[3].position = affine3f(CreateTranslationMatrix4<float>(20.0f, 20.0f, 20.0f));
+
+        /* bottom layer */
+
+        rubik_cube[4].col[0] = RED;
+        rubik_cube[4].col[1] = BLACK;
+        rubik_cube[4].col[2] = BLACK;
+        rubik_cube[4].col[3] = RUBIK_GREEN;
+        rubik_cube[4].col[4] = YELLOW;
+        rubik_cube[4].col[5] = BLACK;
+        rubik_cube[4].position = affine3f(CreateTranslationMatrix4<float>(-20.0f, -20.0f, -20.0f));
+
+        rubik_cube[5].col[0] = BLACK;
+        rubik_cube[5].col[1] = BLACK;
+        rubik_cube[5].col[2] = ORANGE;
+        rubik_cube[5].col[3] = RUBIK_GREEN;
+        rubik_cube[5].col[4] = YELLOW;
+        rubik_cube[5].col[5] = BLACK;
+        rubik_cube[5].position = affine3f(CreateTranslationMatrix4<float>(20.0f, -20.0f, -20.0f));
+
+        rubik_cube[6].col[0] = RED;
+        rubik_cube[6].col[1] = BLUE;
+        rubik_cube[6].col[2] = BLACK;
+        rubik_cube[6].col[3] = BLACK;
+        rubik_cube[6].col[4] = YELLOW;
+        rubik_cube[6].col[5] = BLACK;
+        rubik_cube[6].position = affine3f(CreateTranslationMatrix4<float>(-20.0f, -20.0f, 20.0f));
+
+        rubik_cube[7].col[0] = BLACK;
+        rubik_cube[7].col[1] = BLUE;
+        rubik_cube[7].col[2] = ORANGE;
+        rubik_cube[7].col[3] = BLACK;
+        rubik_cube[7].col[4] = YELLOW;
+        rubik_cube[7].col[5] = BLACK;
+        rubik_cube[7].position = affine3f(CreateTranslationMatrix4<float>(20.0f, -20.0f, 20.0f));
+
+        flagged_index = -1;
+        flagged_face = -1;
+        on_cube = false;
+
+        //debug
+        normal = vec4f(0.0f, 50.0f, 0.0f, 1.0f);
+        origin = vec4f(0.0f, 0.0f, 0.0f, 1.0f);
+
+        light = vec3f(0.0f, 0.0f, 50.0f).Unit(); // (in world coordinates) light comes out behind the screen (normalized)
+
+        rotating = false;
+        mouselock = false;
+        da = 0.1f;
+
+        scrambling = false;
+
+        currentQ = Quaternion<float>(true);
+        lastQ = Quaternion<float>(true);
+
+        trans = affine3f(CreateTranslationMatrix4<float>(0.0f, 0.0f, -100.0f));
+        modelm = trans;
+        projm = PROJECTION; // viewport is left as it is, the whole screen
+
+        mat4f vpTransfi = Inverse4<float>(viewport);
+        mat4f projmi = Inverse4<float>(projm);
+
+        trans_projmi = projmi * vpTransfi;
+        modelmi = modelm.InverseRigid(); // modelm is a rotation followed by a translation
+        unprojm = modelmi.ToMatrix4() * trans_projmi;
+
+        xscale = 2.0f / (width - 1.0f);
+        yscale = 2.0f / (height - 1.0f);
+
+        std::srand(static_cast<unsigned>(time(NULL)));
+    }
+
+    void Rubik::Render()
+    {
+        MYGL_PROFILE_ZONE("Rubik::Render");
+
+        std::fill(mask.begin(), mask.end(), -1); // important!
+
+        affine3f rotate;
+
+        if (rotating)
+        {
+            rotate = affine3f(CreateRotationMatrix3<float>(Quaternion<float>(axis, angle)));
+        }
+
+        for (int idx = 0; idx < 8; ++idx)
+        {
+            // the cubies in the rotation group are turned before they are placed in the world
+            bool turning = rotating && std::find(rotation_group[group], rotation_group[group] + 4, idx) != rotation_group[group] + 4;
+
+            affine3f cubiem = turning ? modelm * rotate * rubik_cube[idx].position : modelm * rubik_cube[idx].position;
+
+            // transforms, culling, lighting, clipping and perspective division are all done by the renderer, the faces
+            // only get their colours and mask ids here
+            DrawModelFaces(cube, cubiem, projm, light, WriteMask(&mask[0], 0), [this, idx](int i, Colour& colour, WriteMask& fragments)
+            {
+                int face = i / 2;
+
+                colour = rubik_cube[idx].col[face];
+
+                // optimization: don't render if the colour matches the background
+                if (colour.argb == BLACK.argb) return false;
+
+                if (idx == flagged_index && face == flagged_face)
+                {
+                    colour = colour.Contrast();
+                }
+
+                fragments.id = (face << 4) | idx;
+                return true;
+            });
+        }
+
+        //debug
+        mat4f vTrans = projm * modelm.ToMatrix4();
+        vec4f n = vTrans * normal;
+        vec4f o = vTrans * origin;
+        n /= n[3];
+        o /= o[3];
+        n = viewport * n;
+        o = viewport * o;
+        DrawLine(o.Demote(), n.Demote(), RED);
+    }
+
+    void Rubik::Update()
+    {
+        MYGL_PROFILE_ZONE("Rubik::Update");
+
+        bool done = false;
+
+        if (!scrambling)
+        {
+            angle += da;
+
+            if (angle >= M_PI_2)
+            {
+                RotateSwap(group, orien);
+                done = true;
+            }
+        }
+        else // scrambling
+        {
+            if (ntimes == 0)
+            {
+                done = true;
+            }
+            else
+            {
+                if (noaxis)
+                {
+                    orien = std::rand() % 6;
+
+                    switch (orien)
+                    {
+                    case 0: axis = xaxis; break;
+                    case 1: axis = -xaxis; break;
+                    case 2: axis = yaxis; break;
+                    case 3: axis = -yaxis; break;
+                    case 4: axis = zaxis; break;
+                    case 5: axis = -zaxis; break;
+                    }
+                    normal = vec4f(axis[0] * 80.0f, axis[1] * 80.0f, axis[2] * 80.0f, 1.0f);
+
+                    which = orien / 2;
+                    group = group_index[which][std::rand() % 8];
+                    angle = 0.0f;
+
+                    noaxis = false;
+                }
+                else
+                {
+                    angle += da;
+
+                    if (angle >= M_PI_2)
+                    {
+                        RotateSwap(group, orien);
+                        ntimes--;
+                        noaxis = true;
+                    }
+                }
+            }
+        }
+
+        if (done)
+        {
+            StopAnimation();
+            rotating = false;
+            mouselock = false;
+            scrambling = false;
+            flagged_index = flagged_face = -1;
+        }
+    }
+
+    void Rubik::StartScramble()
+    {
+        scrambling = true;
+        noaxis = true;
+        mouselock = true;
+        rotating = true;
+        ntimes = 10;
+
+        StartAnimation();
+    }
+
+    void Rubik::HandleMousePress(int mouseX, int mouseY)
+    {
+        if (mouselock) return;
+
+        p = ProjectToSphere(mouseX, mouseY);
+    }
+
+    void Rubik::HandleMouseRelease(int mouseX, int mouseY)
+    {
+        if (mouselock) return;
+
+        lastQ = currentQ * lastQ;
+        currentQ = Quaternion<float>(true);
+    }
+
+    void Rubik::HandleMouseMotion(int mouseX, int mouseY)
+    {
+        if (mouselock) return;
+
+        q = ProjectToSphere(mouseX, mouseY);
+
+        vec3f n = CrossProduct(p, q);
+        float theta = std::acos((p * q) / (p.Magnitude() * q.Magnitude()));
+
+        currentQ = Quaternion<float>(n, theta);
+
+        affine3f rot(CreateRotationMatrix3<float>(currentQ * lastQ));
+        modelm = trans * rot;
+        modelmi = modelm.InverseRigid(); // modelm is a rotation followed by a translation
+        unprojm = modelmi.ToMatrix4() * trans_projmi;
+    }
+
+    void Rubik::HandleRightMouseButtonPress(int mouseX, int mouseY)
+    {
+        if (mouselock) return;
+
+        int offset = PixelOffset(mouseX, mouseY, width);
+
+        flagged_index = mask[offset] & 0b1111;
+        flagged_face = mask[offset] >> 4;
+
+        if ((flagged_index >= 0 && flagged_index < 8) &&
+            (flagged_face >= 0 && flagged_face < 6))
+            on_cube = true;
+
+        std::cerr << "index=" << flagged_index << ", face=" << flagged_face << std::endl;
+
+        p = Unproject(mouseX, mouseY);
+    }
+
+    void Rubik::HandleRightMouseButtonRelease(int mouseX, int mouseY)
+    {
+        if (mouselock) return;
+
+        flagged_index = flagged_face = -1;
+        on_cube = false;
+    }
+
+    void Rubik::HandleMouseMotionR(int mouseX, int mouseY)
+    {
+        if (!on_cube || mouselock) return;
+
+        q = Unproject(mouseX, mouseY);
+
+        vec3f drag = q - p; // drag vector
+
+        if (drag.Magnitude() < 1e-1) return;
+
+        float x = std::fabs(drag[0]);
+        float y = std::fabs(drag[1]);
+        float z = std::fabs(drag[2]);
+
+        // x is the largest
+        if (x > y && x > z) drag[1] = drag[2] = 0.0f;
+
+        // y is the largest
+        else if (y > x && y > z) drag[0] = drag[2] = 0.0f;
+
+        // z is the largest
+        else drag[0] = drag[1] = 0.0f;
+
+        drag = drag.Unit();
+
+        std::cerr << "p=" << p << ", q=" << q << ", drag=" << drag << std::endl;
+
+        Triangle t = cube.triangle[flagged_face * 2];
+
+        vec4f v1 = rubik_cube[flagged_index].position * cube.vertex[t.vertex[0]];
+        vec4f v2 = rubik_cube[flagged_index].position * cube.vertex[t.vertex[1]];
+        vec4f v3 = rubik_cube[flagged_index].position * cube.vertex[t.vertex[2]];
+
+        vec3f vert1 = v1.Demote();
+        vec3f vert2 = v2.Demote();
+        vec3f vert3 = v3.Demote();
+
+        vec3f surface_normal = CrossProduct(vert3 - vert1, vert2 - vert1).Unit(); // normal to the triangle's surface
+
+        x = std::fabs(surface_normal[0]);
+        y = std::fabs(surface_normal[1]);
+        z = std::fabs(surface_normal[2]);
+
+        // x is the largest
+        if (x > y && x > z) surface_normal[1] = surface_normal[2] = 0.0f;
+
+        // y is the largest
+        else if (y > x && y > z) surface_normal[0] = surface_normal[2] = 0.0f;
+
+        // z is the largest
+        else surface_normal[0] = surface_normal[1] = 0.0f;
+
+        std::cerr << "surface_n=" << surface_normal << std::endl;
+
+        vec3f n = CrossProduct(surface_normal, drag); // normal vector for rotation TODO what to do if it is zero?
+
+        std::cerr << "n=" << n << std::endl;
+
+        normal = vec4f(n[0] * 80.0f, n[1] * 80.0f, n[2] * 80.0f, 1.0f);
+
+        rotating = true;
+        mouselock = true;
+
+             if (n == xaxis)  { orien = X_AXIS;   }
+        else if (n == -xaxis) { orien = N_X_AXIS; }
+        else if (n == yaxis)  { orien = Y_AXIS;   }
+        else if (n == -yaxis) { orien = N_Y_AXIS; }
+        else if (n == zaxis)  { orien = Z_AXIS;   }
+        else if (n == -zaxis) { orien = N_Z_AXIS; }
+
+        which = orien / 2;
+        group = group_index[which][flagged_index];
+
+        std::cerr << "which=" << which << ", orien=" << orien << ", group=" << group << std::endl;
+
+        axis = n;
+        angle = 0.0f;
+
+        StartAnimation();
+    }
+
+    vec3f Rubik::ProjectToSphere(int mouseX, int mouseY)
+    {
+        const float r = 1.0f;
+
+        /* x and y are mapped to [-1, 1] */
+        float x = (mouseX * xscale) - 1.0f;
+        float y = 1.0f - (mouseY * yscale);
+        float z;
+
+        float length2 = x * x + y * y;
+
+        if (length2 <= r * r / 2.0f) // inside the sphere
+        {
+            z = std::sqrt(r * r - length2);
+        }
+        else
+        {
+            z = (r * r / 2.0f) / std::sqrt(length2);
+        }
+
+        return vec3f(x, y, z);
+    }
+
+    vec3f Rubik::Unproject(int mouseX, int mouseY)
+    {
+        const float r = 40.0f;
+
+        // it returns world coordinates but we need to fix the z value...
+        vec3f v = (unprojm * vec4f((float) mouseX, (float) mouseY, 1.0f / zdepth[PixelOffset(mouseX, mouseY, width)], 1.0f)).Demote();
+    /*
+        float x = v[0];
+        float y = v[1];
+        float z;
+        float length2 = x * x + y * y;
+        if (length2 <= r * r / 2.0f) // inside the sphere
+        {
+            z = std::sqrt(r * r - length2);
+        }
+        else
+        {
+            z = (r * r / 2.0f) / std::sqrt(length2);
+        }
+    */
+        return v;
+    }
+
+    void Rubik::RotateSwap(int group, int orien)
+    {
+        int i = rotation_group[group][0];
+        int j = rotation_group[group][1];
+        int k = rotation_group[group][2];
+        int l = rotation_group[group][3];
+
+        // cubies from top leftmost corner to bottom right most corner must be indexed 0-7 after swapping
+        // remember top to bottom, left to right and front to back
+
+        switch (orien)
+        {
+        case N_X_AXIS:
+        case Y_AXIS:
+        case Z_AXIS:
+        {
+            std::cerr << "ccw" << std::endl;
+
+            Cubie tmp1 = rubik_cube[i];
+            Cubie tmp2 = rubik_cube[k];
+
+            rubik_cube[i] = rubik_cube[j];
+            rubik_cube[j] = rubik_cube[l];
+            rubik_cube[k] = tmp1;
+            rubik_cube[l] = tmp2;
+
+            break;
+        }
+        case X_AXIS:
+        case N_Y_AXIS:
+        case N_Z_AXIS:
+        {
+            std::cerr << "cw" << std::endl;
+
+            Cubie tmp1 = rubik_cube[i];
+            Cubie tmp2 = rubik_cube[j];
+
+            rubik_cube[i] = rubik_cube[k];
+            rubik_cube[j] = tmp1;
+            rubik_cube[k] = rubik_cube[l];
+            rubik_cube[l] = tmp2;
+
+            break;
+        }
+        }
+
+        affine3f rotate;
+
+        switch (orien)
+        {
+        case X_AXIS:   rotate = affine3f(CreateRotationXMatrix3<float>(M_PI_2));  break;
+        case N_X_AXIS: rotate = affine3f(CreateRotationXMatrix3<float>(-M_PI_2)); break;
+        case Y_AXIS:   rotate = affine3f(CreateRotationYMatrix3<float>(M_PI_2));  break;
+        case N_Y_AXIS: rotate = affine3f(CreateRotationYMatrix3<float>(-M_PI_2)); break;
+        case Z_AXIS:   rotate = affine3f(CreateRotationZMatrix3<float>(M_PI_2));  break;
+        case N_Z_AXIS: rotate = affine3f(CreateRotationZMatrix3<float>(-M_PI_2)); break;
+        }
+
+        // finally apply rotation to each cubie position
+        rubik_cube[i].position = rotate * rubik_cube[i].position;
+        rubik_cube[j].position = rotate * rubik_cube[j].position;
+        rubik_cube[k].position = rotate * rubik_cube[k].position;
+        rubik_cube[l].position = rotate * rubik_cube[l].position;
+    }
+}
+
+#endif /* _RUBIK_H_ */
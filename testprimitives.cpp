@@ -1,4 +1,4 @@
-/* g++ testprimitives.cpp -o testprimitives -lSDL2 */
+/* g++ testprimitives.cpp -o testprimitives -std=c++14 -pthread -lSDL2 */
 
 #include "mygl.h"
 
@@ -90,7 +90,7 @@ void TestPrimitives::Show()
     ClearScreen();
     Render();
 
-    SDL_UpdateTexture(texture, NULL, &pixels[0], width * 4);
+    SDL_UpdateTexture(texture, NULL, Present(), width * 4);
     SDL_RenderCopy(renderer, texture, NULL, NULL);
     SDL_RenderPresent(renderer);
 }
@@ -164,7 +164,7 @@ void TestPrimitives::Render()
             vec3f v1(centerX, centerY, middlez);
             vec3f v2(x, y, z);
 
-            DrawLineDDA(v1, v2, rainbow[i]);
+            DrawLine(v1, v2, rainbow[i]);
 
             angle += 1.0f;
         }